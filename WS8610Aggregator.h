@@ -0,0 +1,146 @@
+/*
+  WS8610Aggregator - Sums up the measures of each sensor over fixed time windows, giving a single
+  record with minimum, maximum and mean value per sensor and measure type at the end of each window.
+
+  Windows are aligned to multiples of their length on the millis() clock. Every sensor and measure
+  type being aggregated takes a slot of a table of AGGREGATE_SLOTS, with integer accumulators, so
+  the memory used is fixed. When the table is full, the slot with the oldest window is released
+  early to make room. Use an aggregator for each window length (e.g. 5 minutes and 1 hour).
+
+  Usage:
+    WS8610Aggregator aggregator(300000); // 5 minutes
+    int n = receiver.receivedMeasures();
+    while(n-- > 0) aggregator.addMeasure(receiver.getNextMeasure());
+    while(aggregator.receivedAggregates(millis()) > 0) {
+        aggregate a = aggregator.getNextAggregate();
+        ...
+    }
+*/
+
+#ifndef WS8610Aggregator_h
+#define WS8610Aggregator_h
+
+#include "WS8610Receiver.h"
+
+#ifndef AGGREGATE_WINDOW
+#define AGGREGATE_WINDOW 300000 // ms
+#endif
+#ifndef AGGREGATE_SLOTS
+#define AGGREGATE_SLOTS 16      // Sensors and measure types aggregated at the same time
+#endif
+#define AGGREGATE_BUFFER_SIZE (AGGREGATE_SLOTS + 1) // Room for all the windows ending together
+
+struct aggregate {
+    uint32_t msec;       // Start of the window
+    uint8_t sensorAddr;
+    measureType type;
+    uint16_t count;      // Measures in the window
+    int16_t min;         // Tenths
+    int16_t max;         // Tenths
+    int16_t mean;        // Tenths, rounded
+};
+
+class WS8610Aggregator {
+public:
+    WS8610Aggregator(const uint32_t window = AGGREGATE_WINDOW);
+    void addMeasure(const measure &m);
+    int receivedAggregates(const uint32_t msec);
+    aggregate getNextAggregate();
+    uint16_t getEarlyReleases() const;
+
+private:
+    struct slot {
+        aggregate a;     // count == 0 if the slot is free
+        int32_t sum;
+    };
+
+    uint32_t window;
+    slot slots[AGGREGATE_SLOTS];
+    aggregate aggregates[AGGREGATE_BUFFER_SIZE];
+    int aggregatePos;
+    int lastAggregatePos;
+    uint16_t earlyReleases;
+
+    void release(slot *s);
+};
+
+WS8610Aggregator::WS8610Aggregator(const uint32_t window) {
+    this->window = window;
+    for(int s = 0; s < AGGREGATE_SLOTS; s++) slots[s].a.count = 0;
+    aggregatePos = lastAggregatePos = 0;
+    earlyReleases = 0;
+}
+
+void WS8610Aggregator::addMeasure(const measure &m) {
+    if (m.type == SENSOR_STALE) return;
+    const uint32_t start = m.msec - m.msec % window;
+    const int16_t tenths = measureTenths(m);
+    slot *free = nullptr, *oldest = nullptr;
+    for(int s = 0; s < AGGREGATE_SLOTS; s++) {
+        slot *sl = &slots[s];
+        if (sl->a.count == 0) {
+            if (free == nullptr) free = sl;
+            continue;
+        }
+        if (sl->a.sensorAddr == m.sensorAddr && sl->a.type == m.type) {
+            if (sl->a.msec != start) {
+                release(sl); // Window ended
+                free = sl;
+                break;
+            }
+            if (sl->a.count < 0xFFFF) {
+                sl->a.count++;
+                sl->sum += tenths;
+                if (tenths < sl->a.min) sl->a.min = tenths;
+                if (tenths > sl->a.max) sl->a.max = tenths;
+            }
+            return;
+        }
+        if (oldest == nullptr || sl->a.msec - oldest->a.msec > 0x7FFFFFFF) oldest = sl;
+    }
+    if (free == nullptr) {
+        // Table full: the oldest window is released before its end
+        if (earlyReleases < 0xFFFF) earlyReleases++;
+        release(oldest);
+        free = oldest;
+    }
+    free->a = { start, m.sensorAddr, m.type, 1, tenths, tenths, 0 };
+    free->sum = tenths;
+}
+
+/**
+ * Releases the windows ended before msec and returns how many aggregates are ready
+ */
+int WS8610Aggregator::receivedAggregates(const uint32_t msec) {
+    const uint32_t start = msec - msec % window;
+    for(int s = 0; s < AGGREGATE_SLOTS; s++) {
+        if (slots[s].a.count != 0 && slots[s].a.msec != start) release(&slots[s]);
+    }
+    int ready = aggregatePos - lastAggregatePos;
+    if (ready < 0) ready += AGGREGATE_BUFFER_SIZE;
+    return ready;
+}
+
+aggregate WS8610Aggregator::getNextAggregate() {
+    if (lastAggregatePos == aggregatePos) return { 0, 0, TEMPERATURE, 0, 0, 0, 0 };
+    aggregate a = aggregates[lastAggregatePos];
+    if (++lastAggregatePos == AGGREGATE_BUFFER_SIZE) lastAggregatePos = 0;
+    return a;
+}
+
+/**
+ * Returns how many aggregates have been released before the end of their window because the table was full
+ */
+uint16_t WS8610Aggregator::getEarlyReleases() const {
+    return earlyReleases;
+}
+
+void WS8610Aggregator::release(slot *s) {
+    const int32_t count = s->a.count;
+    // Rounded half away from zero
+    s->a.mean = (s->sum >= 0)? (s->sum + count / 2) / count : -((-s->sum + count / 2) / count);
+    aggregates[aggregatePos] = s->a;
+    if (++aggregatePos == AGGREGATE_BUFFER_SIZE) aggregatePos = 0;
+    s->a.count = 0;
+}
+#endif
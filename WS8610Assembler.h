@@ -0,0 +1,137 @@
+/*
+  WS8610Assembler - Joins the temperature and humidity measures sent by a sensor in the same
+  transmission into a single reading.
+
+  Every ~57 seconds a TX3-TH sensor sends a temperature frame (twice) followed by a humidity frame.
+  Measures are kept in a small table of pending readings, one per sensor, until both values are
+  received. A pending reading older than READING_PAIR_WINDOW ms is released with the values it has,
+  so temperature-only sensors and lost frames still produce readings.
+
+  Usage:
+    int n = receiver.receivedMeasures();
+    while(n-- > 0) assembler.addMeasure(receiver.getNextMeasure());
+    while(assembler.receivedReadings(millis()) > 0) {
+        reading r = assembler.getNextReading();
+        ...
+    }
+*/
+
+#ifndef WS8610Assembler_h
+#define WS8610Assembler_h
+
+#include "WS8610Receiver.h"
+
+#ifndef READING_PAIR_WINDOW
+#define READING_PAIR_WINDOW 3000 // ms
+#endif
+#ifndef READING_PENDING_SLOTS
+#define READING_PENDING_SLOTS 8  // Sensors that can be waiting for their second measure
+#endif
+#define READING_BUFFER_SIZE 5
+
+enum readingFlags : uint8_t {HAS_TEMPERATURE = 1, HAS_HUMIDITY = 2};
+
+struct reading {
+    uint32_t msec;       // Time of the first measure
+    uint8_t sensorAddr;
+    uint8_t flags;       // HAS_TEMPERATURE and/or HAS_HUMIDITY
+    int16_t temperature; // Tenths of °C
+    int16_t humidity;    // Tenths of %rh
+};
+
+class WS8610Assembler {
+public:
+    WS8610Assembler();
+    void addMeasure(const measure &m);
+    int receivedReadings(const uint32_t msec);
+    reading getNextReading();
+    uint16_t getHalfReadings() const;
+
+private:
+    reading pending[READING_PENDING_SLOTS]; // Slots with flags == 0 are free
+    reading readings[READING_BUFFER_SIZE];
+    int readingPos;
+    int lastReadingPos;
+    uint16_t halfReadings;
+
+    void release(reading *r);
+};
+
+WS8610Assembler::WS8610Assembler() {
+    for(int s = 0; s < READING_PENDING_SLOTS; s++) pending[s].flags = 0;
+    readingPos = lastReadingPos = 0;
+    halfReadings = 0;
+}
+
+void WS8610Assembler::addMeasure(const measure &m) {
+    if (m.type == SENSOR_STALE) return;
+    const uint8_t flag = (m.type == TEMPERATURE)? HAS_TEMPERATURE : HAS_HUMIDITY;
+    reading *slot = nullptr, *oldest = nullptr;
+    for(int s = 0; s < READING_PENDING_SLOTS; s++) {
+        reading *r = &pending[s];
+        if (r->flags == 0) {
+            if (slot == nullptr) slot = r;
+            continue;
+        }
+        if (r->sensorAddr == m.sensorAddr) {
+            if (m.msec - r->msec > READING_PAIR_WINDOW) {
+                release(r); // Belongs to the previous transmission
+                slot = r;
+                break;
+            }
+            // Repeated frames of the same transmission are ignored
+            if (!(r->flags & flag)) {
+                if (flag == HAS_TEMPERATURE) r->temperature = measureTenths(m);
+                else r->humidity = measureTenths(m);
+                r->flags |= flag;
+                if (r->flags == (HAS_TEMPERATURE | HAS_HUMIDITY)) release(r);
+            }
+            return;
+        }
+        if (oldest == nullptr || r->msec - oldest->msec > 0x7FFFFFFF) oldest = r;
+    }
+    if (slot == nullptr) {
+        // Table full: the oldest pending reading won't wait any longer
+        release(oldest);
+        slot = oldest;
+    }
+    slot->msec = m.msec;
+    slot->sensorAddr = m.sensorAddr;
+    slot->flags = flag;
+    slot->temperature = (flag == HAS_TEMPERATURE)? measureTenths(m) : 0;
+    slot->humidity = (flag == HAS_HUMIDITY)? measureTenths(m) : 0;
+}
+
+/**
+ * Releases the pending readings older than READING_PAIR_WINDOW and returns how many readings are ready
+ */
+int WS8610Assembler::receivedReadings(const uint32_t msec) {
+    for(int s = 0; s < READING_PENDING_SLOTS; s++) {
+        if (pending[s].flags != 0 && msec - pending[s].msec > READING_PAIR_WINDOW) release(&pending[s]);
+    }
+    int ready = readingPos - lastReadingPos;
+    if (ready < 0) ready += READING_BUFFER_SIZE;
+    return ready;
+}
+
+reading WS8610Assembler::getNextReading() {
+    if (lastReadingPos == readingPos) return { 0, 0, 0, 0, 0 };
+    reading r = readings[lastReadingPos];
+    if (++lastReadingPos == READING_BUFFER_SIZE) lastReadingPos = 0;
+    return r;
+}
+
+/**
+ * Returns how many readings have been released with only one of the two values
+ */
+uint16_t WS8610Assembler::getHalfReadings() const {
+    return halfReadings;
+}
+
+void WS8610Assembler::release(reading *r) {
+    if (r->flags != (HAS_TEMPERATURE | HAS_HUMIDITY) && halfReadings < 0xFFFF) halfReadings++;
+    readings[readingPos] = *r;
+    if (++readingPos == READING_BUFFER_SIZE) readingPos = 0;
+    r->flags = 0;
+}
+#endif
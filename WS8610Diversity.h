@@ -0,0 +1,288 @@
+/*
+  WS8610Diversity - Combines the frames received by two radios (e.g. on antennas in different places),
+  each one on its own data pin, so a frame is decoded if either radio gets it.
+
+  Each radio has its own interrupt handler and packet buffer, and packets are decoded with the static
+  decoding steps of WS8610Receiver. Copies of the same frame from both radios (same content, received
+  within DIVERSITY_WINDOW ms) give a single measure, telling which radios decoded it. When the copies fail
+  on both radios, every bit is taken from the radio whose pulses are closer to the nominal widths and the
+  merged frame is checked again: a dropout or a glitch hitting different bits on each radio is recovered.
+
+  Measures are released DIVERSITY_WINDOW ms after their frame, once the other copy can't come anymore.
+  WS8610Receiver keeps its buffers in static members, so use this class instead of receivers on each pin.
+
+  Usage:
+    WS8610Diversity diversity(2, 3);
+    diversity.enableReceive();
+    ...
+    int n = diversity.receivedMeasures();
+    while(n-- > 0) {
+        diversityMeasure d = diversity.getNextMeasure();
+        // d.m is the measure, bit r of d.radios is set if radio r contributed to it
+    }
+*/
+
+#ifndef WS8610Diversity_h
+#define WS8610Diversity_h
+
+#include "WS8610Receiver.h"
+
+#define DIVERSITY_RADIOS 2
+#ifndef DIVERSITY_WINDOW
+#define DIVERSITY_WINDOW 20              // ms, max distance of the copies of a frame from different radios
+#endif
+#ifndef DIVERSITY_PACKET_BUFFER_SIZE
+#define DIVERSITY_PACKET_BUFFER_SIZE 6   // Packets buffered per radio
+#endif
+#define DIVERSITY_FRAMES 6               // Frames waiting for their copies
+#define DIVERSITY_BUFFER_SIZE 10
+
+struct diversityMeasure {
+    measure m;
+    uint8_t radios;     // Bit r set if radio r decoded the frame (or gave bits to the merged one)
+    bool merged;        // Failed on every radio and recovered merging their bits
+};
+
+struct diversityStats {
+    uint16_t decoded[DIVERSITY_RADIOS];   // Frames decoded by each radio
+    uint16_t exclusive[DIVERSITY_RADIOS]; // Frames decoded by that radio alone
+    uint16_t merged;                      // Frames recovered merging the bits of the failed copies
+    uint16_t unrecovered;                 // Packets failed on every radio (noise included)
+};
+
+class WS8610Diversity {
+public:
+    WS8610Diversity(const int pin0, const int pin1);
+    void enableReceive();
+    void disableReceive();
+    int receivedMeasures();
+    diversityMeasure getNextMeasure();
+    diversityStats getStats() const;
+
+    static void softBits(const volatile uint32_t timings[TIMINGS_BUFFER_SIZE], const timingProfile &tp,
+                         uint8_t bytes[6], uint8_t confidence[TIMINGS_BUFFER_SIZE / 2]);
+
+private:
+    struct heldFrame {
+        uint32_t msec;
+        uint8_t bytes[6];
+        uint8_t radios;  // Radios that decoded the frame
+        uint8_t failed;  // Radios whose copy failed, 0 with radios if the slot is free
+        bool merged;
+        uint8_t confidence[TIMINGS_BUFFER_SIZE / 2]; // Of each bit, while the frame isn't decoded
+    };
+
+    static pulseFramer framers[DIVERSITY_RADIOS];
+    static volatile packet packets[DIVERSITY_RADIOS][DIVERSITY_PACKET_BUFFER_SIZE];
+    static volatile int packetPos[DIVERSITY_RADIOS];
+    int radioInterrupts[DIVERSITY_RADIOS];
+    int lastPacketPos[DIVERSITY_RADIOS];
+    timingProfile profile;
+    heldFrame held[DIVERSITY_FRAMES];
+    diversityMeasure measures[DIVERSITY_BUFFER_SIZE];
+    int measurePos;
+    int lastMeasurePos;
+    diversityStats stats;
+
+    template<uint8_t R> static void handleInterrupt();
+    void addPacket(const uint8_t radio, const volatile packet *p);
+    heldFrame* findFrame(const uint32_t msec, const uint8_t bytes[6]);
+    void release(heldFrame *h);
+    static void count(uint16_t &counter);
+};
+
+pulseFramer WS8610Diversity::framers[DIVERSITY_RADIOS];
+volatile packet WS8610Diversity::packets[DIVERSITY_RADIOS][DIVERSITY_PACKET_BUFFER_SIZE];
+volatile int WS8610Diversity::packetPos[DIVERSITY_RADIOS] = { 0 };
+
+WS8610Diversity::WS8610Diversity(const int pin0, const int pin1) {
+#ifdef ESP8266
+    radioInterrupts[0] = pin0;
+    radioInterrupts[1] = pin1;
+#else
+    radioInterrupts[0] = digitalPinToInterrupt(pin0);
+    radioInterrupts[1] = digitalPinToInterrupt(pin1);
+#endif
+    profile = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+    for(int h = 0; h < DIVERSITY_FRAMES; h++) held[h].radios = held[h].failed = 0;
+    measurePos = lastMeasurePos = 0;
+    stats = { { 0, 0 }, { 0, 0 }, 0, 0 };
+}
+
+void WS8610Diversity::enableReceive() {
+    for(int r = 0; r < DIVERSITY_RADIOS; r++) packetPos[r] = lastPacketPos[r] = 0;
+    attachInterrupt(radioInterrupts[0], handleInterrupt<0>, CHANGE);
+    attachInterrupt(radioInterrupts[1], handleInterrupt<1>, CHANGE);
+}
+
+void WS8610Diversity::disableReceive() {
+    for(int r = 0; r < DIVERSITY_RADIOS; r++) detachInterrupt(radioInterrupts[r]);
+}
+
+template<uint8_t R>
+void RECEIVE_ATTR WS8610Diversity::handleInterrupt() {
+    static uint32_t lastTime = 0;
+
+    const uint32_t time = micros();
+    const uint32_t duration = time - lastTime;
+    lastTime = time;
+    if (WS8610Receiver::addPulse(framers[R], duration)) {
+        packets[R][packetPos[R]].msec = millis();
+        WS8610Receiver::copyTimings(framers[R], packets[R][packetPos[R]].timings);
+        if (++packetPos[R] == DIVERSITY_PACKET_BUFFER_SIZE) packetPos[R] = 0;
+    }
+}
+
+/**
+ * Decodes the packets received by the radios, in time order, and returns how many measures are ready
+ */
+int WS8610Diversity::receivedMeasures() {
+    for(;;) {
+        int radio = -1;
+        for(int r = 0; r < DIVERSITY_RADIOS; r++) {
+            if (lastPacketPos[r] == packetPos[r]) continue;
+            if (radio < 0 || (int32_t)(packets[r][lastPacketPos[r]].msec -
+                                       packets[radio][lastPacketPos[radio]].msec) < 0) radio = r;
+        }
+        if (radio < 0) break;
+        addPacket(radio, &packets[radio][lastPacketPos[radio]]);
+        if (++lastPacketPos[radio] == DIVERSITY_PACKET_BUFFER_SIZE) lastPacketPos[radio] = 0;
+    }
+
+    // Frames whose copies can't come anymore
+    const uint32_t now = millis();
+    for(int h = 0; h < DIVERSITY_FRAMES; h++) {
+        if ((held[h].radios | held[h].failed) != 0 && (int32_t)(now - held[h].msec) > DIVERSITY_WINDOW) {
+            release(&held[h]);
+        }
+    }
+
+    int unreadMeasures = measurePos - lastMeasurePos;
+    if (unreadMeasures < 0) unreadMeasures += DIVERSITY_BUFFER_SIZE;
+    return unreadMeasures;
+}
+
+diversityMeasure WS8610Diversity::getNextMeasure() {
+    if (lastMeasurePos == measurePos) return { { 0, 0, TEMPERATURE, 0, 0 }, 0, false };
+    const diversityMeasure d = measures[lastMeasurePos];
+    if (++lastMeasurePos == DIVERSITY_BUFFER_SIZE) lastMeasurePos = 0;
+    return d;
+}
+
+diversityStats WS8610Diversity::getStats() const {
+    return stats;
+}
+
+/**
+ * Decodes every bit of a packet to the closest of the short and long pulse widths, even out of tolerance,
+ * with its confidence: 0 halfway between them or far from both, 255 at the nominal widths
+ */
+void WS8610Diversity::softBits(const volatile uint32_t timings[TIMINGS_BUFFER_SIZE], const timingProfile &tp,
+                               uint8_t bytes[6], uint8_t confidence[TIMINGS_BUFFER_SIZE / 2]) {
+    const int32_t half = ((int32_t)tp.longPw - tp.shortPw) / 2;
+    for(int b = 0; b < 6; b++) bytes[b] = 0;
+    for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+        const int32_t pulse1 = timings[2*b];
+        // Last timing is the sync signal, in place of the fixed part of the last bit
+        const int32_t pulse2 = (b == TIMINGS_BUFFER_SIZE / 2 - 1)? tp.fixedPw : timings[2*b + 1];
+        const int32_t toShort = (pulse1 > tp.shortPw)? pulse1 - tp.shortPw : tp.shortPw - pulse1;
+        const int32_t toLong = (pulse1 > tp.longPw)? pulse1 - tp.longPw : tp.longPw - pulse1;
+        const int32_t toFixed = (pulse2 > tp.fixedPw)? pulse2 - tp.fixedPw : tp.fixedPw - pulse2;
+        const int bit = (toShort < toLong)? 1 : 0;
+        const int32_t margin = half - (bit? toShort : toLong) - toFixed;
+        confidence[b] = (margin <= 0)? 0 : (margin >= half)? 255 : margin * 255 / half;
+        bytes[b / 8] = (bytes[b / 8] << 1) | bit;
+    }
+}
+
+void WS8610Diversity::addPacket(const uint8_t radio, const volatile packet *p) {
+    const uint8_t bit = 1 << radio;
+    uint8_t bytes[6], confidence[TIMINGS_BUFFER_SIZE / 2];
+    const bool decoded = WS8610Receiver::decodeFrame(p->timings, profile, bytes) == FRAME_OK;
+    if (decoded) count(stats.decoded[radio]);
+    else softBits(p->timings, profile, bytes, confidence);
+
+    heldFrame *h = findFrame(p->msec, decoded? bytes : nullptr);
+    if (h == nullptr) {
+        // New frame, in a free slot or in the one of the oldest frame
+        h = &held[0];
+        for(int f = 0; f < DIVERSITY_FRAMES && (h->radios | h->failed) != 0; f++) {
+            if ((held[f].radios | held[f].failed) == 0 || (int32_t)(held[f].msec - h->msec) < 0) h = &held[f];
+        }
+        if ((h->radios | h->failed) != 0) release(h);
+        h->msec = p->msec;
+        h->radios = h->failed = 0;
+        h->merged = false;
+    }
+    else if (h->radios != 0) {
+        // Already decoded by another radio
+        if (decoded) h->radios |= bit;
+        else h->failed |= bit;
+        return;
+    }
+
+    if (decoded) {
+        // Failed copies of other radios, if any, aren't needed anymore
+        for(int b = 0; b < 6; b++) h->bytes[b] = bytes[b];
+        h->radios = bit;
+        h->failed = 0;
+        return;
+    }
+    if (h->failed == 0) {
+        for(int b = 0; b < 6; b++) h->bytes[b] = bytes[b];
+        for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) h->confidence[b] = confidence[b];
+        h->failed = bit;
+        return;
+    }
+    // Every copy failed so far: each bit is taken from the most confident one
+    for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+        if (confidence[b] <= h->confidence[b]) continue;
+        const int byte = b / 8, shift = (b < 40)? 7 - b % 8 : 43 - b;
+        h->bytes[byte] = (h->bytes[byte] & ~(1 << shift)) | (((bytes[byte] >> shift) & 1) << shift);
+        h->confidence[b] = confidence[b];
+    }
+    h->failed |= bit;
+    if (WS8610Receiver::checkFrame(h->bytes) == FRAME_OK) {
+        h->radios = h->failed;
+        h->failed = 0;
+        h->merged = true;
+    }
+}
+
+/**
+ * Returns the frame held within DIVERSITY_WINDOW ms of msec with the same bytes (any frame not decoded
+ * yet matches, as does any frame if bytes is nullptr), or nullptr
+ */
+WS8610Diversity::heldFrame* WS8610Diversity::findFrame(const uint32_t msec, const uint8_t bytes[6]) {
+    heldFrame *found = nullptr;
+    for(int f = 0; f < DIVERSITY_FRAMES; f++) {
+        heldFrame *h = &held[f];
+        if ((h->radios | h->failed) == 0) continue;
+        const int32_t distance = (int32_t)(msec - h->msec);
+        if (distance > DIVERSITY_WINDOW || distance < -DIVERSITY_WINDOW) continue;
+        if (bytes == nullptr || h->radios == 0) {
+            if (found == nullptr) found = h;
+            continue;
+        }
+        bool same = true;
+        for(int b = 0; b < 6 && same; b++) same = (h->bytes[b] == bytes[b]);
+        if (same) return h;
+    }
+    return found;
+}
+
+void WS8610Diversity::release(heldFrame *h) {
+    if (h->radios == 0) count(stats.unrecovered);
+    else {
+        measures[measurePos] = { WS8610Receiver::frameMeasure(h->bytes, h->msec), h->radios, h->merged };
+        if (++measurePos == DIVERSITY_BUFFER_SIZE) measurePos = 0;
+        if (h->merged) count(stats.merged);
+        else if (h->radios == 1 || h->radios == 2) count(stats.exclusive[h->radios - 1]);
+    }
+    h->radios = h->failed = 0;
+}
+
+void WS8610Diversity::count(uint16_t &counter) {
+    if (counter < 0xFFFF) counter++;
+}
+#endif
@@ -0,0 +1,475 @@
+/*
+  WS8610History - Keeps a compressed history of the measures in a ring of flash or EEPROM pages, to
+  be replayed after a loss of the uplink.
+
+  Each page starts with a 32 bit sequence number and goes on with a stream of bit packed records.
+  Every sensor and measure type takes a slot of the page with its first record, which gives the
+  sensor address; the records that follow give the time as delta of delta (in HISTORY_TIME_UNIT ms)
+  and the value as delta from the previous record of the slot:
+
+    slot      0 = the slot expected to send next, 1 + HISTORY_SLOT_BITS bits (all ones is the end of the page)
+    new slot  8 bits sensorAddr | type << 7, then time (as delta from the previous record of the page)
+              and value (as delta from 0)
+    time      0 = same delta, 10 + 3 bits, 110 + 9 bits (delta of delta), 111 + 32 bits (time)
+    value     0 = same value, 10 + 5 bits, 110 + 9 bits (delta), 111 + 11 bits (value)
+
+  Sensors send at a steady period and their values change slowly, so most records take 3-10 bits.
+  A page has slots for HISTORY_SLOTS sensors and measure types (15 sensors sending both); more
+  than that fill the pages with first records, so a page starts over as soon as its slots are full
+  and holds far fewer measures. Each slot takes 16 bytes of RAM (13 on AVR) in the page being
+  written and in the one being replayed, about 1 KB in all (800 bytes on AVR): with more sensors
+  and RAM to spare define HISTORY_SLOT_BITS as 6 (31 sensors sending both, twice the RAM) before
+  including this header; pages written with a different width can't be read back.
+  A value repeated within a time unit (the temperature frame is sent twice) is stored only once.
+  Pages are written in sequence and the oldest one is erased when the ring is full, so all the
+  pages wear the same. Pages are decoded independently of each other: larger pages spend less on
+  the first records of the slots, smaller ones lose less history when erased.
+
+  The storage is any class with these methods (see eepromPages below, and extras/host/PageStore.h
+  for the host one):
+    uint16_t pageSize() const;
+    uint16_t pageCount() const;
+    void read(uint16_t page, uint16_t offset, uint8_t *data, uint16_t length);
+    void write(uint16_t page, uint16_t offset, const uint8_t *data, uint16_t length); // Only clears bits
+    void erase(uint16_t page);                                                          // Sets all bits
+
+  Usage:
+    #include <EEPROM.h>
+    eepromPages pages;
+    WS8610History<eepromPages> history(pages);
+    history.begin();                                    // Finds the last page written, false if less than 2 pages
+    ...
+    history.addMeasure(receiver.getNextMeasure());
+    ...
+    history.replay([](const measure &m) { ... });      // Measures not replayed yet, oldest first
+
+  The replay position isn't stored: after a restart replay() starts again from the oldest measure.
+  Nor is the clock: msec is stored as given, so after a restart the measures of the previous runs
+  come back with the millis() of the run that stored them, which can't be compared with the new
+  ones. When the replayed times must stay meaningful across restarts, set msec of the measures to
+  a time that survives them (e.g. from an RTC, in ms modulo 2^32) before addMeasure().
+*/
+
+#ifndef WS8610History_h
+#define WS8610History_h
+
+#include "WS8610Receiver.h"
+
+#ifndef HISTORY_TIME_UNIT
+#define HISTORY_TIME_UNIT 1000 // ms
+#endif
+#ifndef HISTORY_SLOT_BITS
+#define HISTORY_SLOT_BITS 5 // 31 slots: 2 x 500 bytes of RAM (2 x 410 on AVR), 6 bits doubles it
+#endif
+#define HISTORY_SLOTS ((1 << HISTORY_SLOT_BITS) - 1) // Sensors and measure types in a page
+#define HISTORY_HEADER_SIZE 4
+#define HISTORY_ERASED 0xFFFFFFFF
+
+#ifdef EEPROM_h
+#ifndef HISTORY_EEPROM_PAGE
+#define HISTORY_EEPROM_PAGE 256 // Bytes
+#endif
+/**
+ * Pages over the whole EEPROM. Bytes are written only if changed, so erasing a page already erased costs nothing
+ */
+class eepromPages {
+public:
+    uint16_t pageSize() const { return HISTORY_EEPROM_PAGE; }
+    uint16_t pageCount() const { return EEPROM.length() / HISTORY_EEPROM_PAGE; }
+    void read(uint16_t page, uint16_t offset, uint8_t *data, uint16_t length) {
+        for(uint16_t b = 0; b < length; b++) data[b] = EEPROM.read(page * HISTORY_EEPROM_PAGE + offset + b);
+    }
+    void write(uint16_t page, uint16_t offset, const uint8_t *data, uint16_t length) {
+        for(uint16_t b = 0; b < length; b++) EEPROM.update(page * HISTORY_EEPROM_PAGE + offset + b, data[b]);
+    }
+    void erase(uint16_t page) {
+        for(uint16_t b = 0; b < HISTORY_EEPROM_PAGE; b++) EEPROM.update(page * HISTORY_EEPROM_PAGE + b, 0xFF);
+    }
+};
+#endif
+
+struct historySlot {
+    uint8_t key;        // sensorAddr | type << 7
+    int16_t tenths;
+    uint16_t record;    // Index in the page of the last record
+    uint32_t time;      // In HISTORY_TIME_UNIT
+    int32_t delta;
+};
+
+// Slots of a page, kept the same way while writing and while reading it
+struct historyPage {
+    historySlot slots[HISTORY_SLOTS];
+    uint8_t used;
+    uint16_t records;
+    uint32_t time;      // Time of the last record
+
+    void clear() {
+        used = 0;
+        records = 0;
+        time = 0;
+    }
+
+    // The slot expected to send first (on a tie, the one that sent first last time), used if there isn't any
+    uint8_t predicted() const {
+        uint8_t best = used;
+        int32_t bestDue = 0;
+        for(uint8_t s = 0; s < used; s++) {
+            const int32_t due = (int32_t)(slots[s].time + slots[s].delta - time);
+            if (best == used || due < bestDue || (due == bestDue && slots[s].record < slots[best].record)) {
+                best = s;
+                bestDue = due;
+            }
+        }
+        return best;
+    }
+
+    void update(const uint8_t slot, const uint8_t key, const uint32_t t, const int16_t tenths) {
+        historySlot &s = slots[slot];
+        if (slot == used) {
+            used++;
+            s.key = key;
+            s.delta = 0;
+        }
+        else s.delta = (int32_t)(t - s.time);
+        s.time = time = t;
+        s.tenths = tenths;
+        s.record = records++;
+    }
+};
+
+static const uint8_t historyTimeWidths[3] = { 3, 9, 32 };
+static const uint8_t historyValueWidths[3] = { 5, 9, 11 };
+
+/**
+ * Appends to bits the code of a delta: 0 if it's 0, otherwise 10 or 110 followed by the delta in the first width
+ * it fits in, or 111 followed by the full value. Returns the bits appended
+ */
+static inline int historyCode(uint64_t &bits, const int32_t delta, const uint8_t widths[3], const bool hasDelta,
+                              const uint32_t full) {
+    if (hasDelta) {
+        if (delta == 0) {
+            bits <<= 1;
+            return 1;
+        }
+        for(int w = 0; w < 2; w++) {
+            const int32_t limit = 1L << (widths[w] - 1);
+            if (delta >= -limit && delta < limit) {
+                bits = (bits << (w + 2)) | ((w == 0)? 0x2 : 0x6);
+                bits = (bits << widths[w]) | ((uint32_t)delta & ((1UL << widths[w]) - 1));
+                return w + 2 + widths[w];
+            }
+        }
+    }
+    bits = (bits << 3) | 0x7;
+    bits = (bits << widths[2]) | ((widths[2] == 32)? full : full & ((1UL << widths[2]) - 1));
+    return 3 + widths[2];
+}
+
+template<typename S>
+class WS8610History {
+public:
+    WS8610History(S &storage);
+    bool begin();
+    void addMeasure(const measure &m);
+    template<typename F> uint32_t replay(F onMeasure);
+    void rewind();
+    uint32_t getStoredMeasures() const;
+    uint16_t getErasedPages() const;
+
+private:
+    S &storage;
+    uint16_t page;          // Page being written
+    uint32_t sequence;      // Its sequence number
+    uint32_t oldestSequence;
+    uint32_t bitPos;        // Next bit to write in the page
+    historyPage current;
+    uint32_t replaySequence; // Replay position: page and records already replayed in it
+    uint16_t replayRecords;
+    uint32_t storedMeasures;
+    uint16_t erasedPages;
+    bool started;           // begin() found a usable storage
+
+    void startPage(const uint16_t p, const uint32_t seq);
+    uint16_t pageOf(const uint32_t seq) const;
+    void append(const uint64_t bits, const int count);
+    bool readBits(const uint16_t p, uint32_t &pos, const int count, uint32_t &value);
+    bool readCode(const uint16_t p, uint32_t &pos, const uint8_t widths[3], int32_t &value, bool &full);
+    template<typename F> void readPage(const uint16_t p, historyPage &hp, uint32_t &end, F onRecord);
+};
+
+template<typename S>
+WS8610History<S>::WS8610History(S &storage) : storage(storage) {
+    page = 0;
+    sequence = oldestSequence = 0;
+    bitPos = HISTORY_HEADER_SIZE * 8;
+    current.clear();
+    replaySequence = 0;
+    replayRecords = 0;
+    storedMeasures = 0;
+    erasedPages = 0;
+    started = false;
+}
+
+/**
+ * Finds the last page written and the end of its records, or starts the ring if the storage is empty.
+ * Returns false, and the history stays disabled, if the storage has less than 2 pages: the oldest page
+ * can't be erased while another one keeps the last measures
+ */
+template<typename S>
+bool WS8610History<S>::begin() {
+    started = storage.pageCount() >= 2;
+    if (!started) return false;
+    bool found = false;
+    for(uint16_t p = 0; p < storage.pageCount(); p++) {
+        uint8_t header[HISTORY_HEADER_SIZE];
+        storage.read(p, 0, header, HISTORY_HEADER_SIZE);
+        const uint32_t seq = header[0] | ((uint32_t)header[1] << 8) | ((uint32_t)header[2] << 16) |
+                             ((uint32_t)header[3] << 24);
+        if (seq == HISTORY_ERASED) continue;
+        if (!found || seq > sequence) {
+            page = p;
+            sequence = seq;
+        }
+        if (!found || seq < oldestSequence) oldestSequence = seq;
+        found = true;
+    }
+    if (!found) {
+        oldestSequence = 0;
+        startPage(0, 0);
+    }
+    // Slots of the last page, as they were after its last record
+    else readPage(page, current, bitPos, [](const historySlot&) {});
+    replaySequence = oldestSequence;
+    replayRecords = 0;
+    return true;
+}
+
+template<typename S>
+void WS8610History<S>::addMeasure(const measure &m) {
+    if (!started || m.type == SENSOR_STALE) return;
+    const uint8_t key = (m.sensorAddr & 0x7F) | (m.type << 7);
+    const uint32_t time = m.msec / HISTORY_TIME_UNIT;
+    const int16_t tenths = measureTenths(m);
+    for(int attempt = 0; attempt < 2; attempt++) {
+        uint8_t slot = 0;
+        while(slot < current.used && current.slots[slot].key != key) slot++;
+        if (slot == HISTORY_SLOTS) {
+            startPage((page + 1) % storage.pageCount(), sequence + 1);
+            continue;
+        }
+        uint64_t bits = 0;
+        int count = 1;
+        if (slot == current.used || slot != current.predicted()) {
+            bits = (1 << HISTORY_SLOT_BITS) | slot;
+            count = 1 + HISTORY_SLOT_BITS;
+        }
+        if (slot == current.used) {
+            bits = (bits << 8) | key;
+            count += 8;
+            count += historyCode(bits, (int32_t)(time - current.time), historyTimeWidths, current.records > 0, time);
+            count += historyCode(bits, tenths, historyValueWidths, true, (uint16_t)tenths);
+        }
+        else {
+            const historySlot &s = current.slots[slot];
+            const int32_t delta = (int32_t)(time - s.time);
+            if (delta >= 0 && delta <= 1 && tenths == s.tenths) return; // Repeated measure
+            count += historyCode(bits, delta - s.delta, historyTimeWidths, true, time);
+            count += historyCode(bits, tenths - s.tenths, historyValueWidths, true, (uint16_t)tenths);
+        }
+        if (bitPos + count > (uint32_t)storage.pageSize() * 8) {
+            startPage((page + 1) % storage.pageCount(), sequence + 1);
+            continue; // The first record of the sensor in the new page
+        }
+        append(bits, count);
+        current.update(slot, key, time, tenths);
+        storedMeasures++;
+        return;
+    }
+}
+
+/**
+ * Calls onMeasure(const measure&) for every measure stored after the last one replayed, oldest first.
+ * Returns how many measures have been replayed
+ */
+template<typename S>
+template<typename F>
+uint32_t WS8610History<S>::replay(F onMeasure) {
+    if (!started) return 0;
+    if (replaySequence < oldestSequence) {
+        // Overwritten before being replayed
+        replaySequence = oldestSequence;
+        replayRecords = 0;
+    }
+    uint32_t replayed = 0;
+    for(; ; replaySequence++, replayRecords = 0) {
+        historyPage hp;
+        uint32_t end;
+        readPage(pageOf(replaySequence), hp, end, [&](const historySlot &s) {
+            if (s.record < replayRecords) return;
+            measure m = { s.time * HISTORY_TIME_UNIT, (uint8_t)(s.key & 0x7F), (s.key & 0x80)? HUMIDITY : TEMPERATURE,
+                          0, 0 };
+            // Same split of measureTenths(): decimals are always added
+            m.units = (s.tenths >= 0)? s.tenths / 10 : -((-s.tenths + 9) / 10);
+            m.decimals = s.tenths - m.units * 10;
+            onMeasure(m);
+            replayed++;
+        });
+        replayRecords = hp.records;
+        if (replaySequence == sequence) break;
+    }
+    return replayed;
+}
+
+/**
+ * Moves the replay position back to the oldest measure stored
+ */
+template<typename S>
+void WS8610History<S>::rewind() {
+    replaySequence = oldestSequence;
+    replayRecords = 0;
+}
+
+/**
+ * Returns how many measures have been stored since the start (repeated ones excluded)
+ */
+template<typename S>
+uint32_t WS8610History<S>::getStoredMeasures() const {
+    return storedMeasures;
+}
+
+/**
+ * Returns how many pages have been erased since the start
+ */
+template<typename S>
+uint16_t WS8610History<S>::getErasedPages() const {
+    return erasedPages;
+}
+
+template<typename S>
+void WS8610History<S>::startPage(const uint16_t p, const uint32_t seq) {
+    storage.erase(p);
+    if (erasedPages < 0xFFFF) erasedPages++;
+    const uint8_t header[HISTORY_HEADER_SIZE] = { (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16),
+                                                  (uint8_t)(seq >> 24) };
+    storage.write(p, 0, header, HISTORY_HEADER_SIZE);
+    page = p;
+    sequence = seq;
+    // The page erased was the oldest one once the ring is full
+    if (sequence - oldestSequence >= storage.pageCount()) oldestSequence = sequence - storage.pageCount() + 1;
+    bitPos = HISTORY_HEADER_SIZE * 8;
+    current.clear();
+}
+
+template<typename S>
+uint16_t WS8610History<S>::pageOf(const uint32_t seq) const {
+    return (page + storage.pageCount() - (sequence - seq) % storage.pageCount()) % storage.pageCount();
+}
+
+/**
+ * Writes count bits (up to 64) at the end of the page. The unused bits of the last byte are left set,
+ * so they read as the end of the page and can still be cleared by the next record
+ */
+template<typename S>
+void WS8610History<S>::append(const uint64_t bits, const int count) {
+    uint8_t bytes[9];
+    const uint16_t first = bitPos >> 3;
+    int offset = bitPos & 7, length = 0;
+    uint8_t byte = 0xFF;
+    if (offset > 0) storage.read(page, first, &byte, 1);
+    for(int left = count; left > 0; ) {
+        int take = 8 - offset;
+        if (take > left) take = left;
+        const uint8_t mask = ((1 << take) - 1) << (8 - offset - take);
+        byte = (byte & ~mask) | (((bits >> (left - take)) << (8 - offset - take)) & mask);
+        left -= take;
+        offset += take;
+        if (offset == 8 || left == 0) {
+            bytes[length++] = byte;
+            byte = 0xFF;
+            offset = 0;
+        }
+    }
+    storage.write(page, first, bytes, length);
+    bitPos += count;
+}
+
+/**
+ * Reads count bits (up to 32) of a page, MSB first. Returns false past the end of the page
+ */
+template<typename S>
+bool WS8610History<S>::readBits(const uint16_t p, uint32_t &pos, const int count, uint32_t &value) {
+    if (pos + count > (uint32_t)storage.pageSize() * 8) return false;
+    value = 0;
+    for(int b = 0; b < count; ) {
+        uint8_t byte;
+        storage.read(p, pos >> 3, &byte, 1);
+        const int offset = pos & 7;
+        int take = 8 - offset;
+        if (take > count - b) take = count - b;
+        value = (value << take) | ((byte >> (8 - offset - take)) & ((1 << take) - 1));
+        pos += take;
+        b += take;
+    }
+    return true;
+}
+
+/**
+ * Reads a code written by historyCode(): value is the delta, or the full value if full is set
+ */
+template<typename S>
+bool WS8610History<S>::readCode(const uint16_t p, uint32_t &pos, const uint8_t widths[3], int32_t &value, bool &full) {
+    int prefix = 0;
+    uint32_t v;
+    while(prefix < 3) {
+        if (!readBits(p, pos, 1, v)) return false;
+        if (v == 0) break;
+        prefix++;
+    }
+    full = prefix == 3;
+    if (prefix == 0) {
+        value = 0;
+        return true;
+    }
+    const int width = widths[prefix - 1];
+    if (!readBits(p, pos, width, v)) return false;
+    value = (width == 32)? (int32_t)v : (int32_t)(v << (32 - width)) >> (32 - width);
+    return true;
+}
+
+/**
+ * Decodes the records of a page into hp, calling onRecord(const historySlot&) with the slot of each record after
+ * it. Returns in end the bit position after the last record
+ */
+template<typename S>
+template<typename F>
+void WS8610History<S>::readPage(const uint16_t p, historyPage &hp, uint32_t &end, F onRecord) {
+    hp.clear();
+    uint32_t pos = HISTORY_HEADER_SIZE * 8, v;
+    end = pos;
+    while(readBits(p, pos, 1, v)) {
+        uint8_t slot = hp.predicted();
+        if (v == 1) {
+            if (!readBits(p, pos, HISTORY_SLOT_BITS, v) || v >= HISTORY_SLOTS) break; // End of the page
+            slot = v;
+        }
+        if (slot > hp.used) break; // Corrupted
+        uint32_t key = (slot < hp.used)? hp.slots[slot].key : 0;
+        int32_t time, tenths;
+        bool fullTime, fullValue;
+        if (slot == hp.used && !readBits(p, pos, 8, key)) break;
+        if (!readCode(p, pos, historyTimeWidths, time, fullTime) ||
+            !readCode(p, pos, historyValueWidths, tenths, fullValue)) break;
+        if (slot == hp.used) {
+            if (!fullTime) time += hp.time;
+        }
+        else {
+            const historySlot &s = hp.slots[slot];
+            if (!fullTime) time += s.time + s.delta;
+            if (!fullValue) tenths += s.tenths;
+        }
+        hp.update(slot, key, time, tenths);
+        end = pos;
+        onRecord(hp.slots[slot]);
+    }
+}
+#endif
@@ -0,0 +1,132 @@
+/*
+  WS8610Output - Sends the decoded measures over a serial port as small binary frames, instead of
+  several Serial.print() calls of text for each one.
+
+  Each measure is a record of 7 bytes plus a CRC-8, framed with COBS (Consistent Overhead Byte
+  Stuffing) and a 0 byte delimiter: 10 bytes on the wire, written at once only if they fit in the
+  transmit buffer, otherwise the frame is dropped so loop() never waits for the serial port.
+
+  Record (little-endian):
+    uint32_t msec
+    uint8_t  sensorAddr | 0x80 for humidity
+    int16_t  value in tenths (see measureTenths()), OUTPUT_STALE for a SENSOR_STALE measure
+    uint8_t  CRC-8 (polynomial 0x07) of the previous 7 bytes
+
+  Usage:
+    WS8610Output output;
+    while(receiver.receivedMeasures() > 0) output.writeMeasure(Serial, receiver.getNextMeasure());
+
+  The host side decoder is extras/host/MeasureStream.h.
+*/
+
+#ifndef WS8610Output_h
+#define WS8610Output_h
+
+#include "WS8610Receiver.h"
+
+#define OUTPUT_RECORD_SIZE 8                       // Including the CRC
+#define OUTPUT_FRAME_SIZE (OUTPUT_RECORD_SIZE + 2) // COBS overhead byte and delimiter
+#define OUTPUT_STALE (-32768)                      // Value of a SENSOR_STALE measure
+
+/**
+ * CRC-8 with polynomial 0x07, initial value 0
+ */
+inline uint8_t outputCrc8(const uint8_t *data, const int length) {
+    uint8_t crc = 0;
+    for(int b = 0; b < length; b++) {
+        crc ^= data[b];
+        for(int bit = 0; bit < 8; bit++) crc = (crc & 0x80)? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+/**
+ * COBS encodes length (< 254) bytes into out, adding the 0 delimiter. Returns the bytes written (length + 2)
+ */
+inline int cobsEncode(const uint8_t *data, const int length, uint8_t *out) {
+    int code = 0, n = 1;
+    for(int b = 0; b < length; b++) {
+        if (data[b] == 0) {
+            out[code] = n - code;
+            code = n++;
+        }
+        else out[n++] = data[b];
+    }
+    out[code] = n - code;
+    out[n++] = 0;
+    return n;
+}
+
+/**
+ * Decodes a COBS frame (without its delimiter) into out. Returns the decoded length or -1 if the frame is invalid
+ */
+inline int cobsDecode(const uint8_t *frame, const int length, uint8_t *out) {
+    int n = 0;
+    for(int b = 0; b < length; ) {
+        const int code = frame[b++];
+        if (code == 0 || b + code - 1 > length) return -1;
+        for(int c = 1; c < code; c++) out[n++] = frame[b++];
+        if (b < length) out[n++] = 0;
+    }
+    return n;
+}
+
+inline void encodeMeasureRecord(const measure &m, uint8_t record[OUTPUT_RECORD_SIZE]) {
+    const int16_t tenths = (m.type == SENSOR_STALE)? OUTPUT_STALE : measureTenths(m);
+    for(int b = 0; b < 4; b++) record[b] = m.msec >> (8 * b);
+    record[4] = (m.sensorAddr & 0x7F) | ((m.type == HUMIDITY) << 7);
+    record[5] = tenths & 0xFF;
+    record[6] = (uint16_t)tenths >> 8;
+    record[7] = outputCrc8(record, OUTPUT_RECORD_SIZE - 1);
+}
+
+/**
+ * Decodes a record, returns false if its CRC doesn't match
+ */
+inline bool decodeMeasureRecord(const uint8_t record[OUTPUT_RECORD_SIZE], measure &m) {
+    if (outputCrc8(record, OUTPUT_RECORD_SIZE - 1) != record[7]) return false;
+    const int16_t tenths = (int16_t)(record[5] | (record[6] << 8));
+    m.msec = record[0] | ((uint32_t)record[1] << 8) | ((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+    m.sensorAddr = record[4] & 0x7F;
+    m.type = (record[4] & 0x80)? HUMIDITY : TEMPERATURE;
+    if (tenths == OUTPUT_STALE) {
+        m.type = SENSOR_STALE;
+        m.units = m.decimals = 0;
+        return true;
+    }
+    // Same split of measureTenths(): decimals are always added
+    m.units = (tenths >= 0)? tenths / 10 : -((-tenths + 9) / 10);
+    m.decimals = tenths - m.units * 10;
+    return true;
+}
+
+class WS8610Output {
+public:
+    WS8610Output() : droppedFrames(0) {}
+
+    /**
+     * Writes a measure to a Print with availableForWrite() (e.g. Serial). Returns false, and counts the frame
+     * as dropped, if the transmit buffer hasn't room for the whole frame
+     */
+    template<typename S>
+    bool writeMeasure(S &out, const measure &m) {
+        if (out.availableForWrite() < OUTPUT_FRAME_SIZE) {
+            if (droppedFrames < 0xFFFF) droppedFrames++;
+            return false;
+        }
+        uint8_t record[OUTPUT_RECORD_SIZE], frame[OUTPUT_FRAME_SIZE];
+        encodeMeasureRecord(m, record);
+        out.write(frame, cobsEncode(record, OUTPUT_RECORD_SIZE, frame));
+        return true;
+    }
+
+    /**
+     * Returns how many frames have been dropped because the transmit buffer was full
+     */
+    uint16_t getDroppedFrames() const { return droppedFrames; }
+
+private:
+    uint16_t droppedFrames;
+};
+
+#endif
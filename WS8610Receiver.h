@@ -70,6 +70,116 @@
 #define MEASURE_BUFFER_SIZE 10
 #define NOISE_THRESHOLD 180     // Typical noise pulse duration
 
+// Adaptive timing: define WS8610_ADAPTIVE_TIMING before including this header to
+// track the pulse widths actually sent by each sensor and re-center the windows on them.
+// The tolerance of a settled profile follows the spread of the pulses of that sensor, never
+// below the nominal one
+#ifndef ADAPTIVE_PROFILES
+#define ADAPTIVE_PROFILES 8     // Number of per-sensor timing profiles
+#endif
+#ifndef ADAPTIVE_MARGIN
+#define ADAPTIVE_MARGIN 60      // Added to the spread observed to get the tolerance
+#endif
+#ifndef ADAPTIVE_MAX_DRIFT
+#define ADAPTIVE_MAX_DRIFT 250  // Max distance of adapted pulse widths from the nominal ones
+#endif
+#define ADAPTIVE_MAX_TOLERANCE 350 // Below half the distance of short and long pulses
+#define ADAPTIVE_RATE 2         // Running average weight is 1/2^ADAPTIVE_RATE
+#define ADAPTIVE_WARMUP 4       // Frames needed before a profile uses its own tolerance
+#define ADAPTIVE_MAX_FAILURES 3 // Failed frames in a row after which a profile is dropped
+
+// Pulse histogram: define WS8610_PULSE_HISTOGRAM to count the pulse durations seen by the
+// interrupt handler (before noise filtering). Last bucket counts all the longer pulses
+#ifndef HISTOGRAM_BUCKET_WIDTH
+#define HISTOGRAM_BUCKET_WIDTH 32 // µs
+#endif
+#ifndef HISTOGRAM_BUCKETS
+#define HISTOGRAM_BUCKETS 188     // Up to ~6 ms
+#endif
+
+// Raw capture: define WS8610_RAW_CAPTURE to keep every pulse seen by the interrupt handler in a ring,
+// read encoded with readRawBytes() (see the format there) and sent e.g. over Serial
+#ifndef RAW_BUFFER_SIZE
+#define RAW_BUFFER_SIZE 128     // Pulses, at most 256
+#endif
+#ifndef RAW_SYNC_INTERVAL
+#define RAW_SYNC_INTERVAL 256   // Pulses between two sync markers
+#endif
+#define RAW_RESOLUTION 4        // µs, the resolution of micros() on 16 MHz AVR boards
+
+// Address filter: define WS8610_ADDRESS_FILTER to drop the frames of unwanted sensors (e.g. neighbours'
+// ones) once they are checked, so they never take a slot in the measures buffer
+
+// Report on change: define WS8610_REPORT_ON_CHANGE to drop the measures that differ from the last one reported
+// by the same sensor (and type) by no more than the deadband, unless the heartbeat interval has passed since then
+#ifdef WS8610_REPORT_ON_CHANGE
+#ifndef CHANGE_DEADBAND
+#define CHANGE_DEADBAND 0       // Tenths, 0 drops only repeated values
+#endif
+#ifndef CHANGE_HEARTBEAT
+#define CHANGE_HEARTBEAT 600000 // ms, max time without a report from a sensor
+#endif
+#endif
+
+// Stale sensors: define WS8610_STALE_SENSORS to get a SENSOR_STALE measure when a sensor seen before misses
+// STALE_MISSED transmissions. Deadlines are kept in a hashed timer wheel of STALE_WHEEL_SLOTS ticks
+#ifdef WS8610_STALE_SENSORS
+#ifndef STALE_MISSED
+#define STALE_MISSED 3          // Transmissions missed before the sensor is stale
+#endif
+#define STALE_PERIOD 57000      // ms between two transmissions
+#define STALE_TICK 4000         // ms
+#define STALE_WHEEL_SLOTS 64    // Ticks per revolution of the wheel
+#define STALE_NONE 0xFF
+#endif
+
+// Plausibility filter: define WS8610_PLAUSIBILITY to drop the frames that pass the checksum but aren't valid
+// measures: digits above 9 or not matching their repeat, values out of range or changing faster than a sensor can
+#ifdef WS8610_PLAUSIBILITY
+#ifndef PLAUSIBLE_SENSORS
+#define PLAUSIBLE_SENSORS 8             // Sensors whose last values are kept
+#endif
+#ifndef PLAUSIBLE_TEMPERATURE_RATE
+#define PLAUSIBLE_TEMPERATURE_RATE 10   // Tenths per minute
+#endif
+#ifndef PLAUSIBLE_TEMPERATURE_STEP
+#define PLAUSIBLE_TEMPERATURE_STEP 20   // Tenths, change always allowed
+#endif
+#ifndef PLAUSIBLE_HUMIDITY_RATE
+#define PLAUSIBLE_HUMIDITY_RATE 20      // Tenths per minute
+#endif
+#ifndef PLAUSIBLE_HUMIDITY_STEP
+#define PLAUSIBLE_HUMIDITY_STEP 50      // Tenths, change always allowed
+#endif
+#ifndef PLAUSIBLE_CONFIRM_WINDOW
+#define PLAUSIBLE_CONFIRM_WINDOW 0      // ms, if not 0 a temperature needs its repeat within this time
+#endif
+#define PLAUSIBLE_ACCEPTED 0x01
+#define PLAUSIBLE_HELD 0x04
+#define PLAUSIBLE_PENDING 0x10
+#endif
+
+// Collision detection: define WS8610_COLLISION_DETECTION to flag the packets where overlapping transmissions were
+// merged, and to look for a frame ended without its sync signal (the next transmission started right after it)
+// in the timings before the packet window
+#ifdef WS8610_COLLISION_DETECTION
+#ifndef COLLISION_LEAD
+#define COLLISION_LEAD 88             // Timings kept before the packet window
+#endif
+#define COLLISION_MIN_EXTRA 8         // Timings between two sync signals beyond a frame that flag a collision
+#define COLLISION_MIN_VIOLATIONS 4    // Pulses out of tolerance before a clean frame end that flag a collision
+#define COLLISION_CLEAN_BITS 8        // Bits at the end of the window that must decode for the above
+#define COLLISION_BUFFER_SIZE 4       // Packets whose lead timings are kept at the same time
+#define COLLISION_BUCKETS 6           // Buckets counting the collisions of the last hour
+#define COLLISION_BUCKET_MSEC 600000
+#define COLLISION_NONE 0xFF
+#define FRAMER_SIZE (TIMINGS_BUFFER_SIZE + COLLISION_LEAD)
+#else
+#define FRAMER_SIZE TIMINGS_BUFFER_SIZE
+#endif
+
+// Packet statistics: define WS8610_PACKET_STATS to count the packets decoded and rejected by decodePacket()
+
 #ifdef ESP8266
     // interrupt handler and related code must be in RAM on ESP8266
     #define RECEIVE_ATTR ICACHE_RAM_ATTR
@@ -77,48 +187,292 @@
     #define RECEIVE_ATTR
 #endif
 
-enum measureType : uint8_t {TEMPERATURE, HUMIDITY};
+enum measureType : uint8_t {TEMPERATURE, HUMIDITY, SENSOR_STALE};
+enum frameStatus : uint8_t {FRAME_OK, TIMINGS_MISMATCH, WRONG_START, PARITY_ERROR, CHECKSUM_ERROR};
 
 struct packet {
     uint32_t msec;
     uint32_t timings[TIMINGS_BUFFER_SIZE];
+#ifdef WS8610_COLLISION_DETECTION
+    uint16_t run;         // Timings since the previous sync signal
+    uint8_t lead;         // Slot of the timings before the window, COLLISION_NONE if there are none
+#endif
+};
+
+struct pulseFramer {
+    uint32_t timings[FRAMER_SIZE]; // Rolling buffer of the last pulses
+    int timingPos;
+    uint32_t lastSync;    // Number of timings since last sync signal
+    uint32_t noiseTiming; // Timing interpolation for noise filter
+#ifdef WS8610_COLLISION_DETECTION
+    uint32_t lastRun;     // Timings between the last two sync signals
+#endif
+};
+
+#ifdef WS8610_COLLISION_DETECTION
+struct collisionLead {
+    uint32_t msec;        // Of the packet, with its slot to tell if the timings are still the packet ones
+    uint8_t packet;
+    uint8_t count;
+    uint16_t timings[COLLISION_LEAD]; // Oldest first, the last one is right before the window
+};
+
+struct collisionStats {
+    uint16_t collisions;  // Packets with overlapping transmissions
+    uint16_t recovered;   // Frames found in the timings before a packet window
+};
+#endif
+
+struct timingProfile {
+    uint16_t fixedPw;
+    uint16_t shortPw;
+    uint16_t longPw;
+    uint16_t tolerance;
+};
+
+#ifdef WS8610_ADAPTIVE_TIMING
+struct sensorProfile {
+    uint32_t msec;      // Last time the profile was updated
+    uint16_t frames;    // Number of frames the profile has been adapted on
+    uint8_t sensorAddr;
+    timingProfile timing;
+    uint16_t spread;    // Largest distance of the pulses from their mean width, decaying
+    uint8_t failures;   // Frames of the sensor failed in a row
+};
+
+struct adaptiveStats {
+    uint16_t adaptedFrames;  // Frames used to update the profiles
+    uint16_t clampedUpdates; // Updates limited by ADAPTIVE_MAX_DRIFT
+    uint16_t evictions;      // Sensor profiles replaced by a new sensor
+    uint16_t drops;          // Profiles dropped after ADAPTIVE_MAX_FAILURES failed frames
+};
+#endif
+
+#ifdef WS8610_PLAUSIBILITY
+struct plausibleSensor {
+    uint32_t msec;          // Last frame of the sensor, 0 if the slot is free
+    uint8_t sensorAddr;
+    uint8_t flags;          // PLAUSIBLE_ACCEPTED << type, PLAUSIBLE_HELD << type, PLAUSIBLE_PENDING
+    int16_t tenths[2];      // Last value accepted per measure type
+    uint32_t acceptedMsec[2];
+    int16_t held[2];        // Last value rejected for changing too fast
+    uint32_t heldMsec[2];
+    int16_t pending;        // Temperature waiting for its repeat
+    uint32_t pendingMsec;
+};
+
+struct plausibilityStats {
+    uint16_t badDigits;     // Digits above 9 or not matching their repeat
+    uint16_t outOfRange;
+    uint16_t tooFast;       // Changes faster than the max rate
+    uint16_t unconfirmed;   // Temperatures whose repeat never came (with PLAUSIBLE_CONFIRM_WINDOW)
+};
+#endif
+
+#ifdef WS8610_PACKET_STATS
+struct packetStats {
+    uint32_t decoded;  // Packets that gave a measure, and frames recovered before them (WS8610_COLLISION_DETECTION)
+    uint32_t rejected; // Packets with timings mismatch, wrong start, parity or checksum error (or not plausible)
 };
+#endif
 
 struct measure {
-    uint32_t msec;
+    uint32_t msec;       // For SENSOR_STALE, the last time the sensor was seen
     uint8_t sensorAddr;
     measureType type;
     int8_t units;
     uint8_t decimals;
 };
 
+/**
+ * Measure value in tenths (decimals are always added, so -26.8 °C is units -27 and decimals 2)
+ */
+inline int16_t measureTenths(const measure &m) {
+    return m.units * 10 + m.decimals;
+}
+
 class WS8610Receiver {
 public:
     WS8610Receiver(const int pin);
     void enableReceive();
     void disableReceive();
     int receivedMeasures();
+    int receivedMeasures(const uint8_t maxPackets, const uint32_t maxUsec = 0);
+    int pendingPackets() const;
     measure getNextMeasure();
+    measure getNextMeasure(const uint8_t maxPackets, const uint32_t maxUsec = 0);
+    void setNominalTiming(const timingProfile &tp);
+#ifdef WS8610_ADAPTIVE_TIMING
+    timingProfile getTimingProfile() const;
+    bool getTimingProfile(const uint8_t sensorAddr, timingProfile &tp) const;
+    adaptiveStats getAdaptiveStats() const;
+    void resetTimingProfiles();
+#endif
+#ifdef WS8610_ADDRESS_FILTER
+    void allowSensor(const uint8_t sensorAddr);
+    void denySensor(const uint8_t sensorAddr);
+    void allowAllSensors();
+    void denyAllSensors();
+    bool sensorAllowed(const uint8_t sensorAddr) const;
+    uint16_t getFilteredFrames() const;
+#endif
+#ifdef WS8610_REPORT_ON_CHANGE
+    void setReportOnChange(const uint16_t deadband, const uint32_t heartbeat);
+    void resetReports();
+    uint16_t getUnchangedMeasures() const;
+#endif
+#ifdef WS8610_STALE_SENSORS
+    bool sensorStale(const uint8_t sensorAddr) const;
+#endif
+#ifdef WS8610_PLAUSIBILITY
+    void setPlausibleRange(const measureType type, const int16_t min, const int16_t max);
+    void resetPlausibility();
+    plausibilityStats getPlausibilityStats() const;
+#endif
+#ifdef WS8610_COLLISION_DETECTION
+    collisionStats getCollisionStats() const;
+    uint16_t getCollisionsLastHour();
+#endif
+#ifdef WS8610_PACKET_STATS
+    packetStats getPacketStats() const;
+#endif
+#ifdef WS8610_RAW_CAPTURE
+    static int readRawBytes(uint8_t *bytes, const int size);
+#endif
+#ifdef WS8610_PULSE_HISTOGRAM
+    static void getPulseHistogram(uint16_t counts[HISTOGRAM_BUCKETS + 1], const bool reset = false);
+    static void resetPulseHistogram();
+#endif
+
+    // Decoding steps, also usable without a receiver (e.g. for offline decoding)
+    static bool addPulse(pulseFramer &f, uint32_t duration);
+    static void copyTimings(const pulseFramer &f, volatile uint32_t timings[TIMINGS_BUFFER_SIZE]);
+#ifdef WS8610_COLLISION_DETECTION
+    static void copyLead(const pulseFramer &f, volatile uint16_t timings[COLLISION_LEAD], const uint8_t count);
+#endif
+    static int decodeBit(const uint32_t pulse1, const uint32_t pulse2, const timingProfile &tp);
+    static bool decodeBits(const volatile uint32_t timings[TIMINGS_BUFFER_SIZE], const int firstBit, const int lastBit,
+                           const timingProfile &tp, uint8_t bytes[6]);
+    static frameStatus checkFrame(const uint8_t bytes[6]);
+    static frameStatus decodeFrame(const volatile uint32_t timings[TIMINGS_BUFFER_SIZE], const timingProfile &tp,
+                                   uint8_t bytes[6]);
+    static measure frameMeasure(const uint8_t bytes[6], const uint32_t msec);
 
 private:
-    static volatile uint32_t timingsBuf[TIMINGS_BUFFER_SIZE];
+    static pulseFramer framer;
     static volatile packet packets[PACKET_BUFFER_SIZE];
     static volatile int packetPos;
+#ifdef WS8610_PULSE_HISTOGRAM
+    static volatile uint16_t pulseHistogram[HISTOGRAM_BUCKETS + 1];
+#endif
+#ifdef WS8610_COLLISION_DETECTION
+    static volatile collisionLead leads[COLLISION_BUFFER_SIZE];
+    static volatile uint8_t leadPos;
+#endif
+#ifdef WS8610_RAW_CAPTURE
+    static volatile uint16_t rawPulses[RAW_BUFFER_SIZE]; // In RAW_RESOLUTION units
+    static volatile uint8_t rawHead;
+    static volatile uint8_t rawTail;
+    static volatile uint32_t rawDropped;
+    static volatile bool rawLost;   // Pulses dropped since the last one buffered
+#endif
     int interrupt;
     int lastPacketPos;
     measure measures[MEASURE_BUFFER_SIZE];
     int measurePos;
     int lastMeasurePos;
+    timingProfile nominalProfile;
+#ifdef WS8610_ADAPTIVE_TIMING
+    sensorProfile globalProfile;
+    sensorProfile sensorProfiles[ADAPTIVE_PROFILES];
+    adaptiveStats adaptive;
+
+    sensorProfile* findProfile(const uint8_t sensorAddr);
+    void adaptProfile(sensorProfile *sp, const volatile packet *p, const uint8_t bytes[6]);
+#endif
+#ifdef WS8610_ADDRESS_FILTER
+    uint8_t allowedSensors[16]; // One bit per sensor address
+    uint16_t filteredFrames;
+#endif
+#ifdef WS8610_REPORT_ON_CHANGE
+    // Last report of each sensor address and measure type, indexed by sensorAddr * 2 + type
+    uint32_t reportedMsec[256];
+    int16_t reportedTenths[256];
+    uint8_t reported[32]; // One bit per entry, set once it has a report
+    uint16_t changeDeadband;
+    uint32_t changeHeartbeat;
+    uint16_t unchangedMeasures;
+
+    bool changed(const measure &m);
+#endif
+#ifdef WS8610_STALE_SENSORS
+    // Sensors waiting for their deadline are in a list for each slot of the wheel
+    uint32_t lastSeen[128];
+    uint8_t staleNext[128];
+    uint8_t stalePrev[128];     // 0x80 | slot for the first sensor of a slot
+    uint8_t staleRounds[128];   // Revolutions of the wheel left, STALE_NONE if not in the wheel
+    uint8_t wheel[STALE_WHEEL_SLOTS];
+    uint8_t wheelSlot;          // Slot of the last tick processed
+    uint32_t wheelMsec;         // Time of the last tick processed
+    uint8_t staleSensors[16];   // One bit per sensor address
+
+    void sensorSeen(const uint8_t sensorAddr, const uint32_t msec);
+    void unschedule(const uint8_t sensorAddr);
+    void checkStale(const uint32_t msec);
+    void addMeasure(const measure &m);
+#endif
+#ifdef WS8610_PLAUSIBILITY
+    int16_t plausibleMin[2];    // Tenths, per measure type
+    int16_t plausibleMax[2];
+    plausibleSensor plausibleSensors[PLAUSIBLE_SENSORS];
+    plausibilityStats plausibility;
+
+    bool plausible(const uint8_t bytes[6], const measure &m);
+    static bool changeAllowed(const measureType type, const int16_t delta, const uint32_t elapsed);
+#endif
+#ifdef WS8610_COLLISION_DETECTION
+    collisionStats collision;
+    uint16_t collisionBuckets[COLLISION_BUCKETS];
+    uint8_t collisionBucket;
+    uint32_t collisionBucketMsec; // Start of the current bucket
+
+    int recoverLeading(const volatile packet *p, const timingProfile &tp);
+    static bool leadBits(const volatile packet *p, const volatile collisionLead *l, const uint8_t count,
+                         const int offset, const timingProfile &tp, uint8_t bytes[6]);
+    static uint32_t leadTiming(const volatile packet *p, const volatile collisionLead *l, const uint8_t count,
+                               const int t);
+    static bool clustered(const volatile packet *p, const timingProfile &tp);
+    static bool withinTolerance(const uint32_t pulse, const uint16_t width, const timingProfile &tp);
+    void countCollision(const uint32_t msec);
+    void advanceCollisions(const uint32_t msec);
+#endif
+#ifdef WS8610_PACKET_STATS
+    packetStats stats;
+#endif
 
     static void handleInterrupt();
-    int decodeBit(const uint32_t pulse1, const uint32_t pulse2);
-    bool decodePacket();
-    bool unreadMeasures();
+    int decodePacket();
+    bool reportMeasure(const measure &m);
+    bool unreadMeasures(const uint8_t maxPackets, const uint32_t maxUsec);
 };
 
-volatile uint32_t WS8610Receiver::timingsBuf[TIMINGS_BUFFER_SIZE];
+pulseFramer WS8610Receiver::framer;
 volatile packet WS8610Receiver::packets[PACKET_BUFFER_SIZE];
 volatile int WS8610Receiver::packetPos = 0;
+#ifdef WS8610_PULSE_HISTOGRAM
+volatile uint16_t WS8610Receiver::pulseHistogram[HISTOGRAM_BUCKETS + 1];
+#endif
+#ifdef WS8610_COLLISION_DETECTION
+volatile collisionLead WS8610Receiver::leads[COLLISION_BUFFER_SIZE];
+volatile uint8_t WS8610Receiver::leadPos = 0;
+#endif
+#ifdef WS8610_RAW_CAPTURE
+volatile uint16_t WS8610Receiver::rawPulses[RAW_BUFFER_SIZE];
+volatile uint8_t WS8610Receiver::rawHead = 0;
+volatile uint8_t WS8610Receiver::rawTail = 0;
+volatile uint32_t WS8610Receiver::rawDropped = 0;
+volatile bool WS8610Receiver::rawLost = false;
+#endif
 
 // Board                               Digital Pins Usable For Interrupts
 // Uno, Nano, Mini, other 328-based    2, 3
@@ -135,6 +489,47 @@ WS8610Receiver::WS8610Receiver(const int pin) {
 #endif
     for(int p = 0; p < PACKET_BUFFER_SIZE; p++) WS8610Receiver::packets[p].msec = 0;
     measurePos = lastMeasurePos = 0;
+    setNominalTiming({ PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE });
+#ifdef WS8610_ADDRESS_FILTER
+    allowAllSensors();
+    filteredFrames = 0;
+#endif
+#ifdef WS8610_REPORT_ON_CHANGE
+    setReportOnChange(CHANGE_DEADBAND, CHANGE_HEARTBEAT);
+    resetReports();
+#endif
+#ifdef WS8610_STALE_SENSORS
+    for(int a = 0; a < 128; a++) staleRounds[a] = STALE_NONE;
+    for(int w = 0; w < STALE_WHEEL_SLOTS; w++) wheel[w] = STALE_NONE;
+    for(int b = 0; b < 16; b++) staleSensors[b] = 0;
+    wheelSlot = 0;
+    wheelMsec = millis();
+#endif
+#ifdef WS8610_PLAUSIBILITY
+    // Range of the TX3-TH sensors
+    setPlausibleRange(TEMPERATURE, -400, 600);
+    setPlausibleRange(HUMIDITY, 0, 1000);
+    resetPlausibility();
+#endif
+#ifdef WS8610_COLLISION_DETECTION
+    collision = { 0, 0 };
+    for(int b = 0; b < COLLISION_BUCKETS; b++) collisionBuckets[b] = 0;
+    collisionBucket = 0;
+    collisionBucketMsec = millis();
+#endif
+#ifdef WS8610_PACKET_STATS
+    stats = { 0, 0 };
+#endif
+}
+
+/**
+ * Changes the pulse widths used for decoding, which are PW_FIXED, PW_SHORT, PW_LONG and PW_TOLERANCE by default
+ */
+void WS8610Receiver::setNominalTiming(const timingProfile &tp) {
+    nominalProfile = tp;
+#ifdef WS8610_ADAPTIVE_TIMING
+    resetTimingProfiles();
+#endif
 }
 
 
@@ -155,137 +550,370 @@ void WS8610Receiver::disableReceive() {
 }
 
 void RECEIVE_ATTR WS8610Receiver::handleInterrupt() {
-    static int timingPos = 0;
     static uint32_t lastTime = 0;
-    static uint32_t lastSync = 0;    // Number of timings since last sync signal
-    static uint32_t noiseTiming = 0; // Timing interpolation for noise filter
 
     const uint32_t time = micros();
-    uint32_t duration = time - lastTime;
+    const uint32_t duration = time - lastTime;
     lastTime = time;
+#ifdef WS8610_PULSE_HISTOGRAM
+    uint32_t bucket = duration / HISTOGRAM_BUCKET_WIDTH;
+    if (bucket > HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS;
+    if (WS8610Receiver::pulseHistogram[bucket] != 0xFFFF) WS8610Receiver::pulseHistogram[bucket]++;
+#endif
+#ifdef WS8610_RAW_CAPTURE
+    uint8_t rawNext = (rawHead + 1 == RAW_BUFFER_SIZE)? 0 : rawHead + 1;
+    if (rawLost && rawNext != rawTail) {
+        // A long silence where pulses have been dropped, so readers resync there
+        WS8610Receiver::rawPulses[rawHead] = 0xFFFF;
+        rawHead = rawNext;
+        rawNext = (rawHead + 1 == RAW_BUFFER_SIZE)? 0 : rawHead + 1;
+        rawLost = false;
+    }
+    if (rawLost || rawNext == rawTail) { // Ring full
+        rawDropped++;
+        rawLost = true;
+    }
+    else {
+        const uint32_t units = duration / RAW_RESOLUTION;
+        WS8610Receiver::rawPulses[rawHead] = (units > 0xFFFF)? 0xFFFF : units;
+        rawHead = rawNext;
+    }
+#endif
+    if (addPulse(WS8610Receiver::framer, duration)) {
+        WS8610Receiver::packets[packetPos].msec = millis();
+        copyTimings(WS8610Receiver::framer, WS8610Receiver::packets[packetPos].timings);
+#ifdef WS8610_COLLISION_DETECTION
+        // Timings since the previous sync signal beyond the window are kept only for the packets with some
+        const uint32_t run = WS8610Receiver::framer.lastRun;
+        WS8610Receiver::packets[packetPos].run = (run > 0xFFFF)? 0xFFFF : run;
+        WS8610Receiver::packets[packetPos].lead = COLLISION_NONE;
+        if (run > TIMINGS_BUFFER_SIZE) {
+            volatile collisionLead *l = &WS8610Receiver::leads[leadPos];
+            l->msec = WS8610Receiver::packets[packetPos].msec;
+            l->packet = packetPos;
+            l->count = (run - TIMINGS_BUFFER_SIZE > COLLISION_LEAD)? COLLISION_LEAD : run - TIMINGS_BUFFER_SIZE;
+            copyLead(WS8610Receiver::framer, l->timings, l->count);
+            WS8610Receiver::packets[packetPos].lead = leadPos;
+            if (++leadPos == COLLISION_BUFFER_SIZE) leadPos = 0;
+        }
+#endif
+        if (++packetPos == PACKET_BUFFER_SIZE) packetPos = 0;
+    }
+}
+
+/**
+ * Adds a pulse to the rolling buffer of the framer. Returns true when a sync signal completes a packet,
+ * whose timings can then be read with copyTimings()
+ */
+bool RECEIVE_ATTR WS8610Receiver::addPulse(pulseFramer &f, uint32_t duration) {
     if (duration < NOISE_THRESHOLD) {
         // Probably this short pulse is noise, so we ignore it
-        WS8610Receiver::timingsBuf[timingPos] += duration / 2;
-        noiseTiming += duration / 2;
-        return;
+        f.timings[f.timingPos] += duration / 2;
+        f.noiseTiming += duration / 2;
+        return false;
     }
-    else if (noiseTiming > 0) {
-        duration += noiseTiming;
-        noiseTiming = 0;
+    else if (f.noiseTiming > 0) {
+        duration += f.noiseTiming;
+        f.noiseTiming = 0;
     }
 
-    if (++timingPos == TIMINGS_BUFFER_SIZE) timingPos = 0;
-    WS8610Receiver::timingsBuf[timingPos] = duration;
-    lastSync++;
+    if (++f.timingPos == FRAMER_SIZE) f.timingPos = 0;
+    f.timings[f.timingPos] = duration;
+    f.lastSync++;
 
     if (duration > 5000) { // Synchronization signal detected
         // Sync signal must be at least one packet away from the previous one
-        if (lastSync > TIMINGS_BUFFER_SIZE) {
-            WS8610Receiver::packets[packetPos].msec = millis();
-            for(int t = 0; t < TIMINGS_BUFFER_SIZE; t++) {
-                if (++timingPos == TIMINGS_BUFFER_SIZE) timingPos = 0;
-                WS8610Receiver::packets[packetPos].timings[t] = WS8610Receiver::timingsBuf[timingPos];
-            }
-            if (++packetPos == PACKET_BUFFER_SIZE) packetPos = 0;
-        }
-        lastSync = 1;
+        const bool packet = (f.lastSync > TIMINGS_BUFFER_SIZE);
+#ifdef WS8610_COLLISION_DETECTION
+        f.lastRun = f.lastSync - 1;
+#endif
+        f.lastSync = 1;
+        return packet;
+    }
+    return false;
+}
+
+/**
+ * Copies the last TIMINGS_BUFFER_SIZE pulses of the framer, from the oldest to the sync signal
+ */
+void RECEIVE_ATTR WS8610Receiver::copyTimings(const pulseFramer &f, volatile uint32_t timings[TIMINGS_BUFFER_SIZE]) {
+    int pos = f.timingPos + FRAMER_SIZE - TIMINGS_BUFFER_SIZE;
+    if (pos >= FRAMER_SIZE) pos -= FRAMER_SIZE;
+    for(int t = 0; t < TIMINGS_BUFFER_SIZE; t++) {
+        if (++pos == FRAMER_SIZE) pos = 0;
+        timings[t] = f.timings[pos];
+    }
+}
+
+#ifdef WS8610_COLLISION_DETECTION
+/**
+ * Copies the count (at most COLLISION_LEAD) pulses of the framer before the ones of copyTimings(), saturated to 16 bits
+ */
+void RECEIVE_ATTR WS8610Receiver::copyLead(const pulseFramer &f, volatile uint16_t timings[COLLISION_LEAD],
+                                           const uint8_t count) {
+    int pos = f.timingPos + FRAMER_SIZE - TIMINGS_BUFFER_SIZE - count;
+    if (pos >= FRAMER_SIZE) pos -= FRAMER_SIZE;
+    for(int t = 0; t < count; t++) {
+        if (++pos == FRAMER_SIZE) pos = 0;
+        timings[t] = (f.timings[pos] > 0xFFFF)? 0xFFFF : f.timings[pos];
     }
 }
+#endif
 
-int WS8610Receiver::decodeBit(const uint32_t pulse1, const uint32_t pulse2) {
+int WS8610Receiver::decodeBit(const uint32_t pulse1, const uint32_t pulse2, const timingProfile &tp) {
     // Check second pulse (fixed width)
-    uint32_t pw_diff = (pulse2 > PW_FIXED)? (pulse2 - PW_FIXED) : (PW_FIXED - pulse2);
-    if (pw_diff > PW_TOLERANCE) return -1;
+    uint32_t pw_diff = (pulse2 > tp.fixedPw)? (pulse2 - tp.fixedPw) : (tp.fixedPw - pulse2);
+    if (pw_diff > tp.tolerance) return -1;
 
     // Check first pulse (long or short)
-    if (pulse1 < PW_SHORT) return ((PW_SHORT - pulse1) < PW_TOLERANCE)? 1 : -1;
-    if (pulse1 > PW_LONG) return ((pulse1 - PW_LONG) < PW_TOLERANCE)? 0 : -1;
-    // pulse1 width is between PW_SHORT and PW_LONG
-    if (pulse1 - PW_SHORT < PW_TOLERANCE) return 1;
-    if (PW_LONG - pulse1 < PW_TOLERANCE) return 0;
+    if (pulse1 < tp.shortPw) return ((tp.shortPw - pulse1) < tp.tolerance)? 1 : -1;
+    if (pulse1 > tp.longPw) return ((pulse1 - tp.longPw) < tp.tolerance)? 0 : -1;
+    // pulse1 width is between short and long
+    if (pulse1 - tp.shortPw < tp.tolerance) return 1;
+    if (tp.longPw - pulse1 < tp.tolerance) return 0;
     return -1;
 }
 
-bool WS8610Receiver::decodePacket() {
-    volatile packet *p = &WS8610Receiver::packets[lastPacketPos];
-    if (++lastPacketPos == PACKET_BUFFER_SIZE) lastPacketPos = 0;
-
-    // Decode and pack the bits into an array of bytes
-    uint8_t bytes[6] = {0};
-    int bit;
-    p->timings[TIMINGS_BUFFER_SIZE - 1] = PW_FIXED;
-    for(int b = 0; b < TIMINGS_BUFFER_SIZE; b += 2) {
-        bit = WS8610Receiver::decodeBit(p->timings[b], p->timings[b+1]);
-        if (bit == -1) {
-//            Serial.printf("Timings mismatch (%d, %d)\n", p->timings[b], p->timings[b+1]);
-            return false; // Timings mismatch
-        }
-
-        bytes[b / 16] <<= 1;
-        if (bit == 1) bytes[b / 16]++;
+/**
+ * Decodes the bits from firstBit to lastBit - 1 and appends them to the bytes array (which must start zeroed).
+ * Returns false on a timings mismatch
+ */
+bool WS8610Receiver::decodeBits(const volatile uint32_t timings[TIMINGS_BUFFER_SIZE], const int firstBit, const int lastBit,
+                                const timingProfile &tp, uint8_t bytes[6]) {
+    for(int b = firstBit; b < lastBit; b++) {
+        // Last timing is the sync signal, in place of the fixed part of the last bit
+        const uint32_t pulse2 = (b == TIMINGS_BUFFER_SIZE / 2 - 1)? tp.fixedPw : timings[2*b + 1];
+        const int bit = decodeBit(timings[2*b], pulse2, tp);
+        if (bit == -1) return false;
+        bytes[b / 8] <<= 1;
+        if (bit == 1) bytes[b / 8]++;
     }
+    return true;
+}
 
+frameStatus WS8610Receiver::checkFrame(const uint8_t bytes[6]) {
     // check start sequence
-    if (bytes[0] != 0x0A) {
-//        Serial.println("Wrong start sequence");
-        return false;
-    }
+    if (bytes[0] != 0x0A) return WRONG_START;
 
     // Check parity. Parity bit is #19 and it makes data bits (from #19 to #31) even
     uint8_t bits = (bytes[2] & 0x1F) ^ bytes[3];
     bits ^= bits >> 4;
     bits ^= bits >> 2;
     bits ^= bits >> 1;
-    if (bits & 1) {
-//        Serial.println("Parity error");
-        return false; // Parity error
-    }
+    if (bits & 1) return PARITY_ERROR;
 
     // Checksum
     uint8_t checksum = 0;
     for(int b = 0; b < 5; b++) checksum += (bytes[b] & 0xF) + (bytes[b] >> 4);
-    if ((checksum & 0xF) != bytes[5]) {
-//        Serial.println("Checksum error");
-        return false; // Checksum error
+    if ((checksum & 0xF) != bytes[5]) return CHECKSUM_ERROR;
+
+    return FRAME_OK;
+}
+
+/**
+ * Decodes the timings of a whole packet into the six bytes of a frame and checks them
+ */
+frameStatus WS8610Receiver::decodeFrame(const volatile uint32_t timings[TIMINGS_BUFFER_SIZE], const timingProfile &tp,
+                                        uint8_t bytes[6]) {
+    for(int b = 0; b < 6; b++) bytes[b] = 0;
+    if (!decodeBits(timings, 0, TIMINGS_BUFFER_SIZE / 2, tp, bytes)) return TIMINGS_MISMATCH;
+    return checkFrame(bytes);
+}
+
+measure WS8610Receiver::frameMeasure(const uint8_t bytes[6], const uint32_t msec) {
+    return {
+        msec,
+        (uint8_t)(((bytes[1] << 3) & 0x7F) + (bytes[2] >> 5)),
+        (bytes[1] >> 4)? HUMIDITY : TEMPERATURE,
+        (int8_t)((bytes[2] & 0xF) * 10 + (bytes[3] >> 4) - ((bytes[1] >> 4)? 0 : 50)),
+        (uint8_t)(bytes[3] & 0xF)
+    };
+}
+
+/**
+ * Decodes the next received packet and returns the number of measures it gave: one, or two when a frame
+ * ended without its sync signal is recovered before it (WS8610_COLLISION_DETECTION)
+ */
+int WS8610Receiver::decodePacket() {
+    volatile packet *p = &WS8610Receiver::packets[lastPacketPos];
+    if (++lastPacketPos == PACKET_BUFFER_SIZE) lastPacketPos = 0;
+
+    // Decode and pack the bits into an array of bytes
+    uint8_t bytes[6] = {0};
+#ifdef WS8610_ADAPTIVE_TIMING
+    // Header and sensor address are decoded with the global profile, the rest of the
+    // packet with the profile of that sensor (if known)
+    sensorProfile *sp = &globalProfile;
+    const timingProfile *tp = &globalProfile.timing;
+#else
+    const timingProfile *tp = &nominalProfile;
+#endif
+#ifdef WS8610_COLLISION_DETECTION
+    // The frame before the window, if any, is the older one
+    const int recovered = recoverLeading(p, *tp);
+#else
+    const int recovered = 0;
+#endif
+    // Bits #12-#18 contain the sensor address
+    bool decoded = decodeBits(p->timings, 0, 19, *tp, bytes);
+#ifdef WS8610_ADAPTIVE_TIMING
+    const uint8_t addr = ((bytes[1] << 3) & 0x7F) + (bytes[2] & 0x7);
+    sensorProfile *found = decoded? findProfile(addr) : nullptr;
+    if (found != nullptr) {
+        sp = found;
+        tp = &found->timing;
+    }
+#endif
+    decoded = decoded && decodeBits(p->timings, 19, TIMINGS_BUFFER_SIZE / 2, *tp, bytes) && checkFrame(bytes) == FRAME_OK;
+    if (!decoded) { // Timings mismatch, wrong start, parity or checksum error
+#ifdef WS8610_ADAPTIVE_TIMING
+        // A profile that keeps failing is dropped, the next frames of the sensor start over from the global one
+        if (sp != &globalProfile && ++sp->failures >= ADAPTIVE_MAX_FAILURES) {
+            sp->frames = 0;
+            if (adaptive.drops < 0xFFFF) adaptive.drops++;
+        }
+#endif
+#ifdef WS8610_PACKET_STATS
+        stats.rejected++;
+#endif
+#ifdef WS8610_COLLISION_DETECTION
+        // Packets joining two frames have been counted already
+        if (p->run < TIMINGS_BUFFER_SIZE + COLLISION_MIN_EXTRA && clustered(p, *tp)) countCollision(p->msec);
+#endif
+        return recovered;
+    }
+
+    const measure m = frameMeasure(bytes, p->msec);
+#ifdef WS8610_ADDRESS_FILTER
+    // Only checked frames are filtered, as in recoverLeading(), so a corrupted address is a rejected packet
+    if (!sensorAllowed(m.sensorAddr)) {
+        if (filteredFrames < 0xFFFF) filteredFrames++;
+        return recovered;
+    }
+#endif
+#ifdef WS8610_PLAUSIBILITY
+    // Before any other use of the frame, since its sensor address may be garbage as well
+    if (!plausible(bytes, m)) {
+#ifdef WS8610_PACKET_STATS
+        stats.rejected++;
+#endif
+        return recovered;
+    }
+#endif
+#ifdef WS8610_PACKET_STATS
+    stats.decoded++;
+#endif
+#ifdef WS8610_ADAPTIVE_TIMING
+    adaptProfile(&globalProfile, p, bytes);
+    if (sp == &globalProfile) {
+        // First frame from this sensor: take a free slot, or the least recently updated one (wrap safe)
+        sp = &sensorProfiles[0];
+        for(int s = 1; s < ADAPTIVE_PROFILES && sp->frames > 0; s++) {
+            if (sensorProfiles[s].frames == 0 || p->msec - sensorProfiles[s].msec > p->msec - sp->msec) {
+                sp = &sensorProfiles[s];
+            }
+        }
+        if (sp->frames > 0) adaptive.evictions++;
+        *sp = globalProfile;
+        sp->sensorAddr = m.sensorAddr;
+        sp->frames = 0;
     }
+    sp->failures = 0;
+    adaptProfile(sp, p, bytes);
+    adaptive.adaptedFrames++;
+#endif
+    return recovered + reportMeasure(m);
+}
+
+/**
+ * Last steps of a decoded measure, from the sensor being seen to the measures buffer. Returns false if it
+ * hasn't been reported
+ */
+bool WS8610Receiver::reportMeasure(const measure &m) {
+#ifdef WS8610_STALE_SENSORS
+    sensorSeen(m.sensorAddr, m.msec);
+#endif
+#ifdef WS8610_REPORT_ON_CHANGE
+    if (!changed(m)) return false;
+#endif
 
-    measures[measurePos].msec = p->msec;
-    measures[measurePos].sensorAddr = ((bytes[1] << 3) & 0x7F) + (bytes[2] >> 5);
-    measures[measurePos].type = (bytes[1] >> 4)? HUMIDITY : TEMPERATURE;
-    measures[measurePos].units = (int8_t)(bytes[2] & 0xF) * 10 + (bytes[3] >> 4) - ((bytes[1] >> 4)? 0 : 50);
-    measures[measurePos].decimals = bytes[3] & 0xF;
+    measures[measurePos] = m;
     if (++measurePos == MEASURE_BUFFER_SIZE) measurePos = 0;
     return true;
 }
 
 int WS8610Receiver::receivedMeasures() {
+    return receivedMeasures(0, 0);
+}
+
+/**
+ * Same as receivedMeasures(), but decodes at most maxPackets of the received packets and stops once maxUsec µs
+ * have passed since the call (0 is no limit for both), leaving the rest to the next calls. A packet takes at most
+ * 44 decodeBit() calls, so this bounds the time spent in loop() after a burst; at least one packet is decoded
+ * per call, so all of them are decoded as long as the calls outpace the transmissions
+ */
+int WS8610Receiver::receivedMeasures(const uint8_t maxPackets, const uint32_t maxUsec) {
+    const uint32_t start = micros();
+#ifdef WS8610_STALE_SENSORS
+    checkStale(millis());
+#endif
     // Counts how many unread measures there are in the buffer
     int unreadMeasures = measurePos - lastMeasurePos;
     if (unreadMeasures < 0) unreadMeasures += MEASURE_BUFFER_SIZE;
 
     // Checks if there is any new measure among the received packets and decodes them
-    while(lastPacketPos != WS8610Receiver::packetPos) {
+    for(uint8_t decoded = 0; lastPacketPos != WS8610Receiver::packetPos; ) {
         // Tries to decode a packet
-        if (decodePacket()) unreadMeasures++;
+        unreadMeasures += decodePacket();
+        if (maxPackets > 0 && ++decoded == maxPackets) break;
+        if (maxUsec > 0 && micros() - start >= maxUsec) break;
     }
     return unreadMeasures;
 }
 
-bool WS8610Receiver::unreadMeasures() {
+/**
+ * Returns how many received packets are still to be decoded
+ */
+int WS8610Receiver::pendingPackets() const {
+    int pending = WS8610Receiver::packetPos - lastPacketPos;
+    if (pending < 0) pending += PACKET_BUFFER_SIZE;
+    return pending;
+}
+
+/**
+ * Returns true if there is an unread measure, decoding the received packets until one gives it, within the same
+ * budget of receivedMeasures(maxPackets, maxUsec)
+ */
+bool WS8610Receiver::unreadMeasures(const uint8_t maxPackets, const uint32_t maxUsec) {
+    const uint32_t start = micros();
+#ifdef WS8610_STALE_SENSORS
+    checkStale(millis());
+#endif
     // Checks if there are unread measures in the buffer
     if (lastMeasurePos != measurePos) return true;
 
     // Checks if there is any new measure in the received packets and decodes it
-    while(lastPacketPos != WS8610Receiver::packetPos) {
+    for(uint8_t decoded = 0; lastPacketPos != WS8610Receiver::packetPos; ) {
         // Tries to decode a packet
-        if (decodePacket()) return true;
+        if (decodePacket() > 0) return true;
+        if (maxPackets > 0 && ++decoded == maxPackets) break;
+        if (maxUsec > 0 && micros() - start >= maxUsec) break;
     }
     return false;
 }
 
 measure WS8610Receiver::getNextMeasure() {
+    return getNextMeasure(0, 0);
+}
+
+/**
+ * Same as getNextMeasure(), but decodes at most maxPackets of the received packets and stops once maxUsec µs have
+ * passed since the call (0 is no limit for both), as receivedMeasures(maxPackets, maxUsec). Returns an empty
+ * measure (msec 0) if none is found within the budget: pendingPackets() tells if there are packets left
+ */
+measure WS8610Receiver::getNextMeasure(const uint8_t maxPackets, const uint32_t maxUsec) {
     // Checks if there are unread measures in the buffer
-    if (!unreadMeasures()) return { 0, 0, TEMPERATURE, 0, 0 };
+    if (!unreadMeasures(maxPackets, maxUsec)) return { 0, 0, TEMPERATURE, 0, 0 };
 
     // There are unread measures in the buffer, get the next one
     measure* m = &measures[lastMeasurePos];
@@ -298,4 +926,532 @@ measure WS8610Receiver::getNextMeasure() {
         m->decimals
     };
 }
+
+#ifdef WS8610_ADAPTIVE_TIMING
+/**
+ * Returns the pulse widths tracked over all the sensors
+ */
+timingProfile WS8610Receiver::getTimingProfile() const {
+    return globalProfile.timing;
+}
+
+/**
+ * Gets the pulse widths tracked for a specific sensor. Returns false if the sensor has no profile
+ */
+bool WS8610Receiver::getTimingProfile(const uint8_t sensorAddr, timingProfile &tp) const {
+    for(int s = 0; s < ADAPTIVE_PROFILES; s++) {
+        if (sensorProfiles[s].frames > 0 && sensorProfiles[s].sensorAddr == sensorAddr) {
+            tp = sensorProfiles[s].timing;
+            return true;
+        }
+    }
+    return false;
+}
+
+adaptiveStats WS8610Receiver::getAdaptiveStats() const {
+    return adaptive;
+}
+
+/**
+ * Forgets every adapted pulse width and restarts from the nominal ones
+ */
+void WS8610Receiver::resetTimingProfiles() {
+    globalProfile = { 0, 0, 0, nominalProfile, 0, 0 };
+    for(int s = 0; s < ADAPTIVE_PROFILES; s++) sensorProfiles[s] = globalProfile;
+    adaptive = { 0, 0, 0, 0 };
+}
+
+sensorProfile* WS8610Receiver::findProfile(const uint8_t sensorAddr) {
+    for(int s = 0; s < ADAPTIVE_PROFILES; s++) {
+        if (sensorProfiles[s].frames > 0 && sensorProfiles[s].sensorAddr == sensorAddr) return &sensorProfiles[s];
+    }
+    return nullptr;
+}
+
+void WS8610Receiver::adaptProfile(sensorProfile *sp, const volatile packet *p, const uint8_t bytes[6]) {
+    // Mean widths of FIXED, SHORT and LONG pulses in this packet
+    uint32_t sums[3] = {0};
+    uint8_t counts[3] = {0};
+    for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+        const int bit = (b < 40)? (bytes[b / 8] >> (7 - b % 8)) & 1 : (bytes[5] >> (43 - b)) & 1;
+        sums[2 - bit] += p->timings[2*b];
+        counts[2 - bit]++;
+        if (b < TIMINGS_BUFFER_SIZE / 2 - 1) { // Last timing is the sync signal
+            sums[0] += p->timings[2*b + 1];
+            counts[0]++;
+        }
+    }
+    uint16_t *widths[3] = { &sp->timing.fixedPw, &sp->timing.shortPw, &sp->timing.longPw };
+    const uint16_t nominal[3] = { nominalProfile.fixedPw, nominalProfile.shortPw, nominalProfile.longPw };
+    // Largest distance of a pulse from the mean width of its kind in this packet
+    uint32_t spread = 0;
+    for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+        const int bit = (b < 40)? (bytes[b / 8] >> (7 - b % 8)) & 1 : (bytes[5] >> (43 - b)) & 1;
+        const uint32_t mean = sums[2 - bit] / counts[2 - bit];
+        const uint32_t pulse = p->timings[2*b];
+        if (((pulse > mean)? pulse - mean : mean - pulse) > spread) spread = (pulse > mean)? pulse - mean : mean - pulse;
+        if (b < TIMINGS_BUFFER_SIZE / 2 - 1) {
+            const uint32_t fixed = p->timings[2*b + 1], fixedMean = sums[0] / counts[0];
+            if (((fixed > fixedMean)? fixed - fixedMean : fixedMean - fixed) > spread) {
+                spread = (fixed > fixedMean)? fixed - fixedMean : fixedMean - fixed;
+            }
+        }
+    }
+    for(int w = 0; w < 3; w++) {
+        if (counts[w] == 0) continue;
+        // Moves the running average towards the mean width observed in this frame
+        int32_t width = *widths[w];
+        width += ((int32_t)(sums[w] / counts[w]) - width) / (1 << ADAPTIVE_RATE);
+        if (width > nominal[w] + ADAPTIVE_MAX_DRIFT) {
+            width = nominal[w] + ADAPTIVE_MAX_DRIFT;
+            adaptive.clampedUpdates++;
+        }
+        else if (width < nominal[w] - ADAPTIVE_MAX_DRIFT) {
+            width = nominal[w] - ADAPTIVE_MAX_DRIFT;
+            adaptive.clampedUpdates++;
+        }
+        *widths[w] = width;
+    }
+    if (sp->frames < 0xFFFF) sp->frames++;
+    // A wider spread is taken at once, a narrower one slowly
+    if (spread > sp->spread) sp->spread = spread;
+    else sp->spread -= (sp->spread - spread) >> ADAPTIVE_RATE;
+    // The global profile mixes every sensor, so its spread covers all of them
+    if (sp->frames >= ADAPTIVE_WARMUP) {
+        uint32_t tolerance = sp->spread + ADAPTIVE_MARGIN;
+        if (tolerance < nominalProfile.tolerance) tolerance = nominalProfile.tolerance;
+        if (tolerance > ADAPTIVE_MAX_TOLERANCE) tolerance = ADAPTIVE_MAX_TOLERANCE;
+        sp->timing.tolerance = tolerance;
+    }
+    sp->msec = p->msec;
+}
+#endif
+
+#ifdef WS8610_REPORT_ON_CHANGE
+/**
+ * Reports a measure only if it differs by more than deadband tenths from the last one reported for the same
+ * sensor and type, or if heartbeat ms have passed since then. The defaults are CHANGE_DEADBAND and CHANGE_HEARTBEAT
+ */
+void WS8610Receiver::setReportOnChange(const uint16_t deadband, const uint32_t heartbeat) {
+    changeDeadband = deadband;
+    changeHeartbeat = heartbeat;
+}
+
+/**
+ * Forgets the last reports, so the next measure of every sensor is reported
+ */
+void WS8610Receiver::resetReports() {
+    for(int b = 0; b < 32; b++) reported[b] = 0;
+    unchangedMeasures = 0;
+}
+
+/**
+ * Returns how many measures have been dropped because they were within the deadband
+ */
+uint16_t WS8610Receiver::getUnchangedMeasures() const {
+    return unchangedMeasures;
+}
+
+bool WS8610Receiver::changed(const measure &m) {
+    const uint8_t e = (m.sensorAddr & 0x7F) * 2 + m.type;
+    const int16_t tenths = measureTenths(m);
+    if (reported[e >> 3] & (1 << (e & 7))) {
+        const int16_t delta = tenths - reportedTenths[e];
+        if ((delta < 0? -delta : delta) <= changeDeadband && m.msec - reportedMsec[e] < changeHeartbeat) {
+            if (unchangedMeasures < 0xFFFF) unchangedMeasures++;
+            return false;
+        }
+    }
+    else reported[e >> 3] |= 1 << (e & 7);
+    reportedMsec[e] = m.msec;
+    reportedTenths[e] = tenths;
+    return true;
+}
+#endif
+
+#ifdef WS8610_STALE_SENSORS
+/**
+ * Returns true if the sensor has been reported as stale and hasn't been seen since then
+ */
+bool WS8610Receiver::sensorStale(const uint8_t sensorAddr) const {
+    return staleSensors[(sensorAddr >> 3) & 0xF] & (1 << (sensorAddr & 7));
+}
+
+void WS8610Receiver::sensorSeen(const uint8_t sensorAddr, const uint32_t msec) {
+    const uint8_t a = sensorAddr & 0x7F;
+    unschedule(a);
+    staleSensors[a >> 3] &= ~(1 << (a & 7));
+    lastSeen[a] = msec;
+    // Due in the tick after the deadline (half a period after the last transmission missed), so it's never early
+    const int32_t due = (int32_t)(msec + STALE_MISSED * STALE_PERIOD + STALE_PERIOD / 2 - wheelMsec);
+    uint32_t ticks = (due < 0)? 1 : due / STALE_TICK + 1;
+    if (ticks > (uint32_t)(STALE_NONE - 1) * STALE_WHEEL_SLOTS) ticks = (uint32_t)(STALE_NONE - 1) * STALE_WHEEL_SLOTS;
+    const uint8_t w = (wheelSlot + ticks) % STALE_WHEEL_SLOTS;
+    staleRounds[a] = (ticks - 1) / STALE_WHEEL_SLOTS;
+    stalePrev[a] = 0x80 | w;
+    staleNext[a] = wheel[w];
+    if (wheel[w] != STALE_NONE) stalePrev[wheel[w]] = a;
+    wheel[w] = a;
+}
+
+void WS8610Receiver::unschedule(const uint8_t sensorAddr) {
+    if (staleRounds[sensorAddr] == STALE_NONE) return;
+    if (stalePrev[sensorAddr] & 0x80) wheel[stalePrev[sensorAddr] & 0x7F] = staleNext[sensorAddr];
+    else staleNext[stalePrev[sensorAddr]] = staleNext[sensorAddr];
+    if (staleNext[sensorAddr] != STALE_NONE) stalePrev[staleNext[sensorAddr]] = stalePrev[sensorAddr];
+    staleRounds[sensorAddr] = STALE_NONE;
+}
+
+/**
+ * Advances the wheel to msec, visiting only the slot of each tick passed
+ */
+void WS8610Receiver::checkStale(const uint32_t msec) {
+    while(msec - wheelMsec >= STALE_TICK) {
+        wheelMsec += STALE_TICK;
+        if (++wheelSlot == STALE_WHEEL_SLOTS) wheelSlot = 0;
+        uint8_t a = wheel[wheelSlot];
+        while(a != STALE_NONE) {
+            const uint8_t next = staleNext[a];
+            if (staleRounds[a] > 0) staleRounds[a]--;
+            else {
+                unschedule(a);
+                staleSensors[a >> 3] |= 1 << (a & 7);
+                addMeasure({ lastSeen[a], a, SENSOR_STALE, 0, 0 });
+            }
+            a = next;
+        }
+    }
+}
+
+void WS8610Receiver::addMeasure(const measure &m) {
+    measures[measurePos] = m;
+    if (++measurePos == MEASURE_BUFFER_SIZE) measurePos = 0;
+}
+#endif
+
+#ifdef WS8610_PLAUSIBILITY
+/**
+ * Changes the range of the accepted values (in tenths) of a measure type
+ */
+void WS8610Receiver::setPlausibleRange(const measureType type, const int16_t min, const int16_t max) {
+    if (type > HUMIDITY) return;
+    plausibleMin[type] = min;
+    plausibleMax[type] = max;
+}
+
+/**
+ * Forgets the last values of the sensors and clears the rejection counters
+ */
+void WS8610Receiver::resetPlausibility() {
+    for(int s = 0; s < PLAUSIBLE_SENSORS; s++) plausibleSensors[s].flags = 0;
+    plausibility = { 0, 0, 0, 0 };
+}
+
+plausibilityStats WS8610Receiver::getPlausibilityStats() const {
+    return plausibility;
+}
+
+/**
+ * Returns true if the measure of a frame that passed checkFrame() can be reported. Every check is O(1): the
+ * digits of the frame, the range of the value, its change from the last value accepted from the same sensor
+ * and, with PLAUSIBLE_CONFIRM_WINDOW, the repeat of a temperature
+ */
+bool WS8610Receiver::plausible(const uint8_t bytes[6], const measure &m) {
+    // Ones and tenths are BCD digits, and tens and ones are sent again in the last data byte
+    if ((bytes[3] >> 4) > 9 || (bytes[3] & 0xF) > 9 || bytes[4] != (((bytes[2] & 0xF) << 4) | (bytes[3] >> 4))) {
+        if (plausibility.badDigits < 0xFFFF) plausibility.badDigits++;
+        return false;
+    }
+    const int16_t tenths = measureTenths(m);
+    if (tenths < plausibleMin[m.type] || tenths > plausibleMax[m.type]) {
+        if (plausibility.outOfRange < 0xFFFF) plausibility.outOfRange++;
+        return false;
+    }
+
+    // Slot of the sensor, or the least recently seen one
+    plausibleSensor *ps = nullptr, *oldest = &plausibleSensors[0];
+    for(int s = 0; s < PLAUSIBLE_SENSORS && ps == nullptr; s++) {
+        plausibleSensor *sl = &plausibleSensors[s];
+        if (sl->flags != 0 && sl->sensorAddr == m.sensorAddr) ps = sl;
+        else if (oldest->flags != 0 && (sl->flags == 0 || m.msec - sl->msec > m.msec - oldest->msec)) oldest = sl;
+    }
+    if (ps == nullptr) {
+        ps = oldest;
+        ps->sensorAddr = m.sensorAddr;
+        ps->flags = 0;
+    }
+    ps->msec = m.msec;
+
+    const uint8_t t = m.type;
+    const bool jump = (ps->flags & (PLAUSIBLE_ACCEPTED << t)) &&
+        !changeAllowed(m.type, tenths - ps->tenths[t], m.msec - ps->acceptedMsec[t]);
+    if (jump) {
+        // A real jump (e.g. the sensor moved indoors) is accepted when the next frame confirms it
+        if (!(ps->flags & (PLAUSIBLE_HELD << t)) ||
+            !changeAllowed(m.type, tenths - ps->held[t], m.msec - ps->heldMsec[t])) {
+            ps->held[t] = tenths;
+            ps->heldMsec[t] = m.msec;
+            ps->flags |= PLAUSIBLE_HELD << t;
+            if (plausibility.tooFast < 0xFFFF) plausibility.tooFast++;
+            return false;
+        }
+    }
+#if PLAUSIBLE_CONFIRM_WINDOW > 0
+    if (m.type == TEMPERATURE) {
+        // The temperature frame is sent twice in a row: the first one waits for the second (or, after a
+        // jump, is the held one)
+        const bool repeat = jump? ps->held[0] == tenths && m.msec - ps->heldMsec[0] <= PLAUSIBLE_CONFIRM_WINDOW :
+            (ps->flags & PLAUSIBLE_PENDING) && ps->pending == tenths && m.msec - ps->pendingMsec <= PLAUSIBLE_CONFIRM_WINDOW;
+        if (!repeat) {
+            if ((ps->flags & PLAUSIBLE_PENDING) && plausibility.unconfirmed < 0xFFFF) plausibility.unconfirmed++;
+            ps->pending = tenths;
+            ps->pendingMsec = m.msec;
+            ps->flags |= PLAUSIBLE_PENDING;
+            return false;
+        }
+        ps->flags &= ~PLAUSIBLE_PENDING;
+    }
+#endif
+    ps->tenths[t] = tenths;
+    ps->acceptedMsec[t] = m.msec;
+    ps->flags = (ps->flags | (PLAUSIBLE_ACCEPTED << t)) & ~(PLAUSIBLE_HELD << t);
+    return true;
+}
+
+/**
+ * Returns true if a change of delta tenths in elapsed ms is within the step and rate allowed for the type
+ */
+bool WS8610Receiver::changeAllowed(const measureType type, const int16_t delta, const uint32_t elapsed) {
+    const uint32_t allowed = (type == TEMPERATURE)?
+        PLAUSIBLE_TEMPERATURE_STEP + (uint32_t)PLAUSIBLE_TEMPERATURE_RATE * (elapsed / 1000) / 60 :
+        PLAUSIBLE_HUMIDITY_STEP + (uint32_t)PLAUSIBLE_HUMIDITY_RATE * (elapsed / 1000) / 60;
+    return (uint32_t)(delta < 0? -delta : delta) <= allowed;
+}
+#endif
+
+#ifdef WS8610_COLLISION_DETECTION
+collisionStats WS8610Receiver::getCollisionStats() const {
+    return collision;
+}
+
+/**
+ * Returns the collisions of the last hour (in 10 minutes steps), to tell how crowded the channel is
+ */
+uint16_t WS8610Receiver::getCollisionsLastHour() {
+    advanceCollisions(millis());
+    uint32_t sum = 0;
+    for(int b = 0; b < COLLISION_BUCKETS; b++) sum += collisionBuckets[b];
+    return (sum > 0xFFFF)? 0xFFFF : sum;
+}
+
+/**
+ * Counts a collision for the packets with more timings since the previous sync signal than a frame, and
+ * looks for a whole frame among the ones before the window: a frame whose sync signal was cut short by the
+ * next transmission. Returns 1 if it gives a measure. A frame overlapped at its start has lost its header,
+ * so isn't recovered (the repeat of a temperature frame may still be received)
+ */
+int WS8610Receiver::recoverLeading(const volatile packet *p, const timingProfile &tp) {
+    if (p->run >= TIMINGS_BUFFER_SIZE + COLLISION_MIN_EXTRA) countCollision(p->msec);
+    if (p->lead == COLLISION_NONE) return 0;
+    const volatile collisionLead *l = &WS8610Receiver::leads[p->lead];
+    // The interrupt handler may have reused the slot for a newer packet
+    if (l->packet != p - WS8610Receiver::packets || l->msec != p->msec) return 0;
+
+    // Header searched at every offset, from the oldest timing on
+    const uint8_t count = (l->count > COLLISION_LEAD)? COLLISION_LEAD : l->count;
+    uint8_t bytes[6];
+    for(int offset = 0; offset < count; offset++) {
+        if (!leadBits(p, l, count, offset, tp, bytes) || checkFrame(bytes) != FRAME_OK) continue;
+        // The frame ended before the timings following it
+        uint32_t after = 0;
+        for(int t = offset; t < count; t++) after += p->timings[TIMINGS_BUFFER_SIZE - count + t];
+        const measure m = frameMeasure(bytes, p->msec - after / 1000);
+#ifdef WS8610_ADDRESS_FILTER
+        if (!sensorAllowed(m.sensorAddr)) {
+            if (filteredFrames < 0xFFFF) filteredFrames++;
+            return 0;
+        }
+#endif
+#ifdef WS8610_PLAUSIBILITY
+        if (!plausible(bytes, m)) {
+#ifdef WS8610_PACKET_STATS
+            stats.rejected++;
+#endif
+            return 0;
+        }
+#endif
+#ifdef WS8610_PACKET_STATS
+        stats.decoded++;
+#endif
+        if (!reportMeasure(m)) return 0;
+        if (collision.recovered < 0xFFFF) collision.recovered++;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Decodes the frame starting offset timings before the window, stopping at the first bits if they aren't the header
+ */
+bool WS8610Receiver::leadBits(const volatile packet *p, const volatile collisionLead *l, const uint8_t count,
+                              const int offset, const timingProfile &tp, uint8_t bytes[6]) {
+    for(int b = 0; b < 6; b++) bytes[b] = 0;
+    for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+        // The last timing is the (short) silence before the next transmission
+        const uint32_t pulse2 = (b == TIMINGS_BUFFER_SIZE / 2 - 1)? tp.fixedPw : leadTiming(p, l, count, offset + 2*b + 1);
+        const int bit = decodeBit(leadTiming(p, l, count, offset + 2*b), pulse2, tp);
+        if (bit == -1) return false;
+        bytes[b / 8] = (bytes[b / 8] << 1) | bit;
+        if (b < 8 && bytes[0] != (0x0A >> (7 - b))) return false;
+    }
+    return true;
+}
+
+/**
+ * Timing t of the count lead timings followed by the window ones
+ */
+uint32_t WS8610Receiver::leadTiming(const volatile packet *p, const volatile collisionLead *l, const uint8_t count,
+                                    const int t) {
+    return (t < count)? l->timings[t] : p->timings[t - count];
+}
+
+/**
+ * Returns true if the window has pulses out of tolerance followed by a clean frame end, as the tail of a frame
+ * whose beginning was overlapped by another transmission. Each pulse is checked on its own against the three
+ * widths, so a noise glitch splitting a pulse (which shifts the bits before it) counts at most two violations
+ */
+bool WS8610Receiver::clustered(const volatile packet *p, const timingProfile &tp) {
+    uint8_t violations = 0;
+    // The last timing is the sync signal
+    for(int t = 0; t < TIMINGS_BUFFER_SIZE - 1; t++) {
+        const uint32_t pulse = p->timings[t];
+        if (withinTolerance(pulse, tp.fixedPw, tp) || withinTolerance(pulse, tp.shortPw, tp) ||
+            withinTolerance(pulse, tp.longPw, tp)) continue;
+        if (t >= TIMINGS_BUFFER_SIZE - 2 * COLLISION_CLEAN_BITS) return false;
+        violations++;
+    }
+    return violations >= COLLISION_MIN_VIOLATIONS;
+}
+
+bool WS8610Receiver::withinTolerance(const uint32_t pulse, const uint16_t width, const timingProfile &tp) {
+    return ((pulse > width)? (pulse - width) : (width - pulse)) < tp.tolerance;
+}
+
+void WS8610Receiver::countCollision(const uint32_t msec) {
+    advanceCollisions(msec);
+    if (collisionBuckets[collisionBucket] < 0xFFFF) collisionBuckets[collisionBucket]++;
+    if (collision.collisions < 0xFFFF) collision.collisions++;
+}
+
+void WS8610Receiver::advanceCollisions(const uint32_t msec) {
+    while((int32_t)(msec - collisionBucketMsec) >= COLLISION_BUCKET_MSEC) {
+        collisionBucketMsec += COLLISION_BUCKET_MSEC;
+        if (++collisionBucket == COLLISION_BUCKETS) collisionBucket = 0;
+        collisionBuckets[collisionBucket] = 0;
+    }
+}
+#endif
+
+#ifdef WS8610_PACKET_STATS
+packetStats WS8610Receiver::getPacketStats() const {
+    return stats;
+}
+#endif
+
+#ifdef WS8610_RAW_CAPTURE
+/**
+ * Moves the buffered pulses into bytes, encoded, and returns the number of bytes written (to be sent
+ * e.g. with Serial.write(bytes, n), sizing the buffer with Serial.availableForWrite()).
+ * Each pulse is a LEB128 varint of duration / RAW_RESOLUTION + 1 (1 byte below 512 µs, at most 3).
+ * Every RAW_SYNC_INTERVAL pulses, and after pulses have been dropped because the ring was full, comes a
+ * sync marker: a 0 byte, then the varints of millis() + 1 and of the total dropped pulses + 1 (both taken
+ * modulo 2^31). A 0 byte is never part of a pulse, so a reader joining the stream at any point starts
+ * from the next marker. Where pulses have been dropped comes a pulse of the longest duration (262 ms),
+ * longer than any sync signal
+ */
+int WS8610Receiver::readRawBytes(uint8_t *bytes, const int size) {
+    static uint16_t sinceSync = RAW_SYNC_INTERVAL;
+    static uint32_t lastDropped = 0;
+    int n = 0;
+    for(;;) {
+        noInterrupts();
+        const uint32_t dropped = rawDropped;
+        interrupts();
+        if (sinceSync >= RAW_SYNC_INTERVAL || dropped != lastDropped) {
+            if (size - n < 11) break;
+            bytes[n++] = 0;
+            const uint32_t fields[2] = { (millis() & 0x7FFFFFFF) + 1, (dropped & 0x7FFFFFFF) + 1 };
+            for(int f = 0; f < 2; f++) {
+                uint32_t value = fields[f];
+                for(; value >= 0x80; value >>= 7) bytes[n++] = (value & 0x7F) | 0x80;
+                bytes[n++] = value;
+            }
+            sinceSync = 0;
+            lastDropped = dropped;
+        }
+        if (rawTail == rawHead || size - n < 3) break;
+        uint32_t value = (uint32_t)WS8610Receiver::rawPulses[rawTail] + 1;
+        rawTail = (rawTail + 1 == RAW_BUFFER_SIZE)? 0 : rawTail + 1;
+        for(; value >= 0x80; value >>= 7) bytes[n++] = (value & 0x7F) | 0x80;
+        bytes[n++] = value;
+        sinceSync++;
+    }
+    return n;
+}
+#endif
+
+#ifdef WS8610_PULSE_HISTOGRAM
+/**
+ * Copies the pulse durations histogram. Bucket b counts the pulses between b * HISTOGRAM_BUCKET_WIDTH
+ * and (b + 1) * HISTOGRAM_BUCKET_WIDTH µs, counts saturate at 65535
+ */
+void WS8610Receiver::getPulseHistogram(uint16_t counts[HISTOGRAM_BUCKETS + 1], const bool reset) {
+    noInterrupts();
+    for(int b = 0; b <= HISTOGRAM_BUCKETS; b++) {
+        counts[b] = WS8610Receiver::pulseHistogram[b];
+        if (reset) WS8610Receiver::pulseHistogram[b] = 0;
+    }
+    interrupts();
+}
+
+void WS8610Receiver::resetPulseHistogram() {
+    noInterrupts();
+    for(int b = 0; b <= HISTOGRAM_BUCKETS; b++) WS8610Receiver::pulseHistogram[b] = 0;
+    interrupts();
+}
+#endif
+
+#ifdef WS8610_ADDRESS_FILTER
+/**
+ * Sensors are all allowed by default. For an allow-list call denyAllSensors() and then
+ * allowSensor() for each wanted sensor, for a deny-list just call denySensor()
+ */
+void WS8610Receiver::allowSensor(const uint8_t sensorAddr) {
+    allowedSensors[(sensorAddr >> 3) & 0xF] |= 1 << (sensorAddr & 7);
+}
+
+void WS8610Receiver::denySensor(const uint8_t sensorAddr) {
+    allowedSensors[(sensorAddr >> 3) & 0xF] &= ~(1 << (sensorAddr & 7));
+}
+
+void WS8610Receiver::allowAllSensors() {
+    for(int b = 0; b < 16; b++) allowedSensors[b] = 0xFF;
+}
+
+void WS8610Receiver::denyAllSensors() {
+    for(int b = 0; b < 16; b++) allowedSensors[b] = 0;
+}
+
+bool WS8610Receiver::sensorAllowed(const uint8_t sensorAddr) const {
+    return allowedSensors[(sensorAddr >> 3) & 0xF] & (1 << (sensorAddr & 7));
+}
+
+/**
+ * Returns how many frames have been dropped by the address filter. Only frames that passed checkFrame() are
+ * counted, and they are counted neither as decoded nor as rejected by the packet stats
+ */
+uint16_t WS8610Receiver::getFilteredFrames() const {
+    return filteredFrames;
+}
+#endif
 #endif
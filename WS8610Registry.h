@@ -0,0 +1,270 @@
+/*
+  WS8610Registry - Maps logical sensors (slots 0 to REGISTRY_SENSORS - 1) to sensor addresses, following
+  a sensor when it takes a new random address after a battery change.
+
+  A slot whose address hasn't been seen for REGISTRY_VANISHED ms is vanished. An unknown address
+  becomes a candidate: once it has sent in two transmissions the same measure types of a vanished
+  slot, with values close to the last ones of the slot (REGISTRY_TEMPERATURE_MATCH and
+  REGISTRY_HUMIDITY_MATCH tenths, plus REGISTRY_DRIFT_PER_HOUR for each hour of absence), a remap
+  of the slot to the new address is proposed. If more vanished slots match, nothing is proposed.
+  With no vanished slot to match, a candidate is proposed for a free slot.
+
+  Remaps of vanished slots are applied at once if autoApply is set, otherwise they are only proposed
+  and applied by applyRemap(), as the ones of new sensors for free slots (they could be neighbours'
+  sensors). All are listed by getNextRemap(), each proposed once per candidate. The change handler
+  is called on any change of the mapping, to persist it (e.g. saving getAddress() of each slot in
+  the EEPROM, and calling assign() at startup).
+
+  Usage:
+    WS8610Registry registry(true);
+    registry.assign(0, 45);                   // Sensor 45 is the slot 0, e.g. read from the EEPROM
+    registry.setChangeHandler(saveSlot);      // void saveSlot(uint8_t slot, uint8_t sensorAddr)
+    ...
+    measure m = receiver.getNextMeasure();
+    int slot = registry.addMeasure(m);        // -1 if the address isn't mapped
+*/
+
+#ifndef WS8610Registry_h
+#define WS8610Registry_h
+
+#include "WS8610Receiver.h"
+
+#ifndef REGISTRY_SENSORS
+#define REGISTRY_SENSORS 8
+#endif
+#ifndef REGISTRY_VANISHED
+#define REGISTRY_VANISHED 300000          // ms without measures
+#endif
+#ifndef REGISTRY_TEMPERATURE_MATCH
+#define REGISTRY_TEMPERATURE_MATCH 20     // Tenths of °C
+#endif
+#ifndef REGISTRY_HUMIDITY_MATCH
+#define REGISTRY_HUMIDITY_MATCH 80        // Tenths of %rh
+#endif
+#define REGISTRY_DRIFT_PER_HOUR 20        // Tenths added to the match tolerance for each hour of absence
+#define REGISTRY_CANDIDATES 4             // Unknown addresses followed at the same time
+#define REGISTRY_TRANSMISSION_GAP 10000   // ms between measures of two different transmissions
+#define REGISTRY_REMAP_BUFFER 5
+#define REGISTRY_NONE 0xFF
+
+enum sensorTypes : uint8_t {SENDS_TEMPERATURE = 1, SENDS_HUMIDITY = 2};
+
+struct remap {
+    uint8_t slot;
+    uint8_t oldAddr;     // REGISTRY_NONE for a free slot
+    uint8_t newAddr;
+    bool applied;
+};
+
+struct registrySensor {
+    uint8_t sensorAddr;  // REGISTRY_NONE if the slot (or candidate) is free
+    uint8_t types;       // SENDS_TEMPERATURE and/or SENDS_HUMIDITY
+    uint8_t transmissions;
+    uint32_t msec;       // Last measure
+    int16_t temperature; // Last values, in tenths
+    int16_t humidity;
+};
+
+class WS8610Registry {
+public:
+    WS8610Registry(const bool autoApply = false);
+    int addMeasure(const measure &m);
+    void assign(const uint8_t slot, const uint8_t sensorAddr);
+    void unassign(const uint8_t slot);
+    int getAddress(const uint8_t slot) const;
+    int getSlot(const uint8_t sensorAddr) const;
+    void setChangeHandler(void (*handler)(uint8_t slot, uint8_t sensorAddr));
+    int receivedRemaps() const;
+    remap getNextRemap();
+    bool applyRemap(const remap &r);
+
+private:
+    bool autoApply;
+    registrySensor sensors[REGISTRY_SENSORS];
+    registrySensor candidates[REGISTRY_CANDIDATES];
+    uint8_t slotOf[128];      // Slot of each address, REGISTRY_NONE if not mapped
+    uint8_t candidateOf[128]; // Candidate of each address, REGISTRY_NONE if not followed
+    uint8_t proposed;         // One bit per candidate already proposed and not applied
+    remap remaps[REGISTRY_REMAP_BUFFER];
+    int remapPos;
+    int lastRemapPos;
+    void (*changeHandler)(uint8_t slot, uint8_t sensorAddr);
+
+    static void update(registrySensor &s, const measure &m);
+    bool matches(const registrySensor &slot, const registrySensor &c) const;
+    void checkCandidate(const uint8_t c);
+};
+
+WS8610Registry::WS8610Registry(const bool autoApply) {
+    this->autoApply = autoApply;
+    for(int a = 0; a < 128; a++) slotOf[a] = candidateOf[a] = REGISTRY_NONE;
+    for(int s = 0; s < REGISTRY_SENSORS; s++) sensors[s].sensorAddr = REGISTRY_NONE;
+    for(int c = 0; c < REGISTRY_CANDIDATES; c++) candidates[c].sensorAddr = REGISTRY_NONE;
+    proposed = 0;
+    remapPos = lastRemapPos = 0;
+    changeHandler = nullptr;
+}
+
+/**
+ * Updates the slot of the sensor and returns it, or -1 if the address isn't mapped (yet)
+ */
+int WS8610Registry::addMeasure(const measure &m) {
+    if (m.type == SENSOR_STALE) return getSlot(m.sensorAddr);
+    const uint8_t a = m.sensorAddr & 0x7F;
+    if (slotOf[a] != REGISTRY_NONE) {
+        update(sensors[slotOf[a]], m);
+        return slotOf[a];
+    }
+    uint8_t c = candidateOf[a];
+    if (c == REGISTRY_NONE) {
+        // Takes a free candidate, or the one not heard for the longest time
+        c = 0;
+        for(uint8_t i = 0; i < REGISTRY_CANDIDATES; i++) {
+            if (candidates[i].sensorAddr == REGISTRY_NONE) {
+                c = i;
+                break;
+            }
+            if (m.msec - candidates[i].msec > m.msec - candidates[c].msec) c = i;
+        }
+        if (candidates[c].sensorAddr != REGISTRY_NONE) candidateOf[candidates[c].sensorAddr] = REGISTRY_NONE;
+        candidates[c] = { a, 0, 0, m.msec, 0, 0 };
+        candidateOf[a] = c;
+        proposed &= ~(1 << c);
+    }
+    update(candidates[c], m);
+    checkCandidate(c);
+    return (slotOf[a] != REGISTRY_NONE)? slotOf[a] : -1;
+}
+
+/**
+ * Maps a slot to a sensor address, removing any other mapping of that address
+ */
+void WS8610Registry::assign(const uint8_t slot, const uint8_t sensorAddr) {
+    if (slot >= REGISTRY_SENSORS) return;
+    const uint8_t a = sensorAddr & 0x7F;
+    if (slotOf[a] != REGISTRY_NONE && slotOf[a] != slot) unassign(slotOf[a]);
+    if (sensors[slot].sensorAddr != REGISTRY_NONE) slotOf[sensors[slot].sensorAddr] = REGISTRY_NONE;
+    const uint8_t c = candidateOf[a];
+    if (c != REGISTRY_NONE) {
+        // Values seen so far are kept
+        sensors[slot] = candidates[c];
+        candidates[c].sensorAddr = REGISTRY_NONE;
+        candidateOf[a] = REGISTRY_NONE;
+    }
+    else sensors[slot] = { a, 0, 0, 0, 0, 0 };
+    slotOf[a] = slot;
+    if (changeHandler != nullptr) changeHandler(slot, a);
+}
+
+void WS8610Registry::unassign(const uint8_t slot) {
+    if (slot >= REGISTRY_SENSORS || sensors[slot].sensorAddr == REGISTRY_NONE) return;
+    slotOf[sensors[slot].sensorAddr] = REGISTRY_NONE;
+    sensors[slot].sensorAddr = REGISTRY_NONE;
+    if (changeHandler != nullptr) changeHandler(slot, REGISTRY_NONE);
+}
+
+/**
+ * Returns the address of the sensor of a slot, or -1 if the slot is free
+ */
+int WS8610Registry::getAddress(const uint8_t slot) const {
+    return (slot < REGISTRY_SENSORS && sensors[slot].sensorAddr != REGISTRY_NONE)? sensors[slot].sensorAddr : -1;
+}
+
+/**
+ * Returns the slot of a sensor address, or -1 if it isn't mapped
+ */
+int WS8610Registry::getSlot(const uint8_t sensorAddr) const {
+    const uint8_t slot = slotOf[sensorAddr & 0x7F];
+    return (slot != REGISTRY_NONE)? slot : -1;
+}
+
+/**
+ * Sets the function called with the slot and its new address (REGISTRY_NONE if freed) on every change
+ */
+void WS8610Registry::setChangeHandler(void (*handler)(uint8_t slot, uint8_t sensorAddr)) {
+    changeHandler = handler;
+}
+
+/**
+ * Returns how many remaps (proposed or applied) are waiting to be read
+ */
+int WS8610Registry::receivedRemaps() const {
+    int ready = remapPos - lastRemapPos;
+    if (ready < 0) ready += REGISTRY_REMAP_BUFFER;
+    return ready;
+}
+
+remap WS8610Registry::getNextRemap() {
+    if (lastRemapPos == remapPos) return { REGISTRY_NONE, REGISTRY_NONE, REGISTRY_NONE, false };
+    remap r = remaps[lastRemapPos];
+    if (++lastRemapPos == REGISTRY_REMAP_BUFFER) lastRemapPos = 0;
+    return r;
+}
+
+/**
+ * Applies a proposed remap, if the slot still has the address it had when proposed
+ */
+bool WS8610Registry::applyRemap(const remap &r) {
+    if (r.slot >= REGISTRY_SENSORS || sensors[r.slot].sensorAddr != r.oldAddr) return false;
+    assign(r.slot, r.newAddr);
+    return true;
+}
+
+void WS8610Registry::update(registrySensor &s, const measure &m) {
+    if (s.transmissions == 0 || m.msec - s.msec > REGISTRY_TRANSMISSION_GAP) {
+        if (s.transmissions < 0xFF) s.transmissions++;
+    }
+    s.msec = m.msec;
+    if (m.type == TEMPERATURE) {
+        s.types |= SENDS_TEMPERATURE;
+        s.temperature = measureTenths(m);
+    }
+    else {
+        s.types |= SENDS_HUMIDITY;
+        s.humidity = measureTenths(m);
+    }
+}
+
+// A candidate matches a vanished slot if it sends the same types, with values close to the last ones of the slot
+bool WS8610Registry::matches(const registrySensor &slot, const registrySensor &c) const {
+    const uint32_t absent = c.msec - slot.msec;
+    if (slot.sensorAddr == REGISTRY_NONE || slot.transmissions == 0 || absent < REGISTRY_VANISHED ||
+        absent > 0x7FFFFFFF || slot.types != c.types) return false;
+    const int32_t drift = (int32_t)(absent / 3600000) * REGISTRY_DRIFT_PER_HOUR;
+    const int32_t dt = c.temperature - slot.temperature, dh = c.humidity - slot.humidity;
+    if ((c.types & SENDS_TEMPERATURE) && (dt < 0? -dt : dt) > REGISTRY_TEMPERATURE_MATCH + drift) return false;
+    if ((c.types & SENDS_HUMIDITY) && (dh < 0? -dh : dh) > REGISTRY_HUMIDITY_MATCH + drift) return false;
+    return true;
+}
+
+void WS8610Registry::checkCandidate(const uint8_t c) {
+    const registrySensor &cs = candidates[c];
+    if (cs.transmissions < 2) return;
+    uint8_t match = REGISTRY_NONE, free = REGISTRY_NONE;
+    for(uint8_t s = 0; s < REGISTRY_SENSORS; s++) {
+        if (sensors[s].sensorAddr == REGISTRY_NONE) {
+            if (free == REGISTRY_NONE) free = s;
+        }
+        else if (matches(sensors[s], cs)) {
+            if (match != REGISTRY_NONE) return; // Ambiguous
+            match = s;
+        }
+    }
+    // A new sensor (maybe a neighbour's one) is only proposed, once
+    bool apply = autoApply;
+    if (match == REGISTRY_NONE) {
+        if (free == REGISTRY_NONE || (proposed & (1 << c))) return;
+        proposed |= 1 << c;
+        match = free;
+        apply = false;
+    }
+    else if (!apply) {
+        if (proposed & (1 << c)) return;
+        proposed |= 1 << c;
+    }
+    const remap r = { match, sensors[match].sensorAddr, cs.sensorAddr, apply };
+    if (apply) assign(match, cs.sensorAddr);
+    remaps[remapPos] = r;
+    if (++remapPos == REGISTRY_REMAP_BUFFER) remapPos = 0;
+}
+#endif
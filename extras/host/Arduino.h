@@ -0,0 +1,94 @@
+/*
+  Minimal Arduino core replacement used to run WS8610Receiver on a host computer.
+
+  Time is simulated: host::pulse() advances the clock by a pulse duration and then
+  fires the pin change interrupt attached by WS8610Receiver::enableReceive(), exactly
+  as an edge on the data pin would do on the board. The clock counts µs on 64 bits, and
+  micros() and millis() truncate it to 32 bits, so they wrap like the board ones (after
+  ~71.6 minutes and ~49.7 days).
+
+  With WS8610_HOST_THREADS defined, the interrupt handler can run on a thread of its own (see
+  host/ThreadedIsr.h): host::pulse() then runs it holding the interrupt lock, which
+  noInterrupts()/interrupts() take and release like disabling interrupts on the board.
+
+  Sketches with more than a data pin (e.g. WS8610Diversity) get a handler per pin: host::pinChange()
+  fires the one of the given pin.
+*/
+
+#ifndef WS8610_HOST_ARDUINO_h
+#define WS8610_HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef WS8610_HOST_THREADS
+#include <atomic>
+#include <mutex>
+#endif
+
+#define CHANGE 1
+#define HOST_PINS 8 // Pins with an interrupt handler of their own
+
+namespace host {
+#ifdef WS8610_HOST_THREADS
+    typedef std::atomic<uint64_t> clockValue;
+
+    inline std::mutex& interruptLock() {
+        static std::mutex lock;
+        return lock;
+    }
+#else
+    typedef uint64_t clockValue;
+#endif
+
+    inline clockValue& clock() {
+        static clockValue usec(0);
+        return usec;
+    }
+
+    inline void (*&isr())() {
+        static void (*handler)() = nullptr;
+        return handler;
+    }
+
+    inline void (*&pinIsr(const int pin))() {
+        static void (*handlers[HOST_PINS])() = { nullptr };
+        return handlers[pin % HOST_PINS];
+    }
+
+    /**
+     * Simulates a level change on the data pin after "duration" µs
+     */
+    inline void pulse(const uint32_t duration) {
+#ifdef WS8610_HOST_THREADS
+        std::lock_guard<std::mutex> lock(host::interruptLock());
+#endif
+        host::clock() += duration;
+        if (host::isr() != nullptr) host::isr()();
+    }
+
+    /**
+     * Simulates a level change on the given pin after "duration" µs from the previous change of any pin
+     */
+    inline void pinChange(const int pin, const uint32_t duration) {
+#ifdef WS8610_HOST_THREADS
+        std::lock_guard<std::mutex> lock(host::interruptLock());
+#endif
+        host::clock() += duration;
+        if (host::pinIsr(pin) != nullptr) host::pinIsr(pin)();
+    }
+}
+
+inline uint32_t micros() { return (uint32_t)host::clock(); }
+inline uint32_t millis() { return (uint32_t)(host::clock() / 1000); }
+inline int digitalPinToInterrupt(const int pin) { return pin; }
+inline void attachInterrupt(int pin, void (*handler)(), int) { host::isr() = host::pinIsr(pin) = handler; }
+inline void detachInterrupt(int pin) { host::isr() = host::pinIsr(pin) = nullptr; }
+#ifdef WS8610_HOST_THREADS
+inline void noInterrupts() { host::interruptLock().lock(); }
+inline void interrupts() { host::interruptLock().unlock(); }
+#else
+inline void noInterrupts() {}
+inline void interrupts() {}
+#endif
+
+#endif
@@ -0,0 +1,171 @@
+/*
+  Decodes many packet windows at once, classifying the same pulse of 4 (SSE2) or 8 (AVX2) windows
+  with a single instruction. The kernel is chosen at runtime, falling back to the scalar
+  WS8610Receiver::decodeFrame() on other CPUs. Results are identical to decodeFrame(): the status,
+  and the frame bytes when the status is not TIMINGS_MISMATCH.
+
+  Windows are stored one after the other, TIMINGS_BUFFER_SIZE timings each.
+  Needs host/Arduino.h and WS8610Receiver.h to be included first.
+*/
+
+#ifndef WS8610_HOST_BATCH_DECODE_h
+#define WS8610_HOST_BATCH_DECODE_h
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_DECODE_X86
+#endif
+
+namespace batch {
+    enum kernel : uint8_t {SCALAR, SSE2, AVX2};
+
+    inline const char* kernelName(const kernel k) {
+        return (k == AVX2)? "AVX2" : (k == SSE2)? "SSE2" : "scalar";
+    }
+
+    inline kernel bestKernel() {
+#ifdef BATCH_DECODE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return AVX2;
+        if (__builtin_cpu_supports("sse2")) return SSE2;
+#endif
+        return SCALAR;
+    }
+
+    // Packs the 44 bits of a frame (bits #0-#21 in hi, #22-#43 in lo) in the decodeFrame() layout
+    inline void packFrame(const uint32_t hi, const uint32_t lo, uint8_t bytes[6]) {
+        const uint64_t frame = ((uint64_t)hi << 22) | lo;
+        for(int b = 0; b < 5; b++) bytes[b] = frame >> (36 - 8 * b);
+        bytes[5] = frame & 0xF;
+    }
+
+#ifdef BATCH_DECODE_X86
+    // Unsigned a > b, SSE2 has only signed comparisons
+    static inline __m128i greater4(const __m128i a, const __m128i b) {
+        const __m128i bias = _mm_set1_epi32(0x80000000);
+        return _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+    }
+
+    /**
+     * Classifies the b-th bit of 4 windows, same rules of WS8610Receiver::decodeBit()
+     */
+    static inline void classify4(const __m128i p1, const __m128i p2, const timingProfile &tp, const bool lastBit,
+                                 __m128i &valid, __m128i &one) {
+        const __m128i fixedPw = _mm_set1_epi32(tp.fixedPw), shortPw = _mm_set1_epi32(tp.shortPw);
+        const __m128i longPw = _mm_set1_epi32(tp.longPw), tolerance = _mm_set1_epi32(tp.tolerance);
+        // Second pulse (fixed width), replaced by the sync signal in the last bit
+        if (!lastBit) {
+            const __m128i above = greater4(p2, fixedPw);
+            const __m128i diff = _mm_or_si128(_mm_and_si128(above, _mm_sub_epi32(p2, fixedPw)),
+                                              _mm_andnot_si128(above, _mm_sub_epi32(fixedPw, p2)));
+            valid = _mm_andnot_si128(greater4(diff, tolerance), valid);
+        }
+        // First pulse (long or short)
+        const __m128i belowShort = greater4(shortPw, p1);
+        const __m128i aboveLong = greater4(p1, longPw);
+        const __m128i between = _mm_xor_si128(_mm_or_si128(belowShort, aboveLong), _mm_set1_epi32(-1));
+        const __m128i shortBelow = _mm_and_si128(belowShort, greater4(tolerance, _mm_sub_epi32(shortPw, p1)));
+        const __m128i longAbove = _mm_and_si128(aboveLong, greater4(tolerance, _mm_sub_epi32(p1, longPw)));
+        const __m128i shortBetween = _mm_and_si128(between, greater4(tolerance, _mm_sub_epi32(p1, shortPw)));
+        const __m128i longBetween = _mm_andnot_si128(shortBetween,
+            _mm_and_si128(between, greater4(tolerance, _mm_sub_epi32(longPw, p1))));
+        one = _mm_or_si128(shortBelow, shortBetween);
+        valid = _mm_and_si128(valid, _mm_or_si128(one, _mm_or_si128(longAbove, longBetween)));
+    }
+
+    static inline void decode4(const uint32_t *windows, const timingProfile &tp, uint32_t hi[4], uint32_t lo[4],
+                               uint32_t valid[4]) {
+        const uint32_t *w0 = windows, *w1 = w0 + TIMINGS_BUFFER_SIZE, *w2 = w1 + TIMINGS_BUFFER_SIZE,
+                       *w3 = w2 + TIMINGS_BUFFER_SIZE;
+        __m128i ok = _mm_set1_epi32(-1), bitsHi = _mm_setzero_si128(), bitsLo = _mm_setzero_si128(), one;
+        for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+            const __m128i p1 = _mm_set_epi32(w3[2*b], w2[2*b], w1[2*b], w0[2*b]);
+            const __m128i p2 = _mm_set_epi32(w3[2*b+1], w2[2*b+1], w1[2*b+1], w0[2*b+1]);
+            classify4(p1, p2, tp, b == TIMINGS_BUFFER_SIZE / 2 - 1, ok, one);
+            if (b < 22) bitsHi = _mm_or_si128(_mm_slli_epi32(bitsHi, 1), _mm_srli_epi32(one, 31));
+            else bitsLo = _mm_or_si128(_mm_slli_epi32(bitsLo, 1), _mm_srli_epi32(one, 31));
+        }
+        _mm_storeu_si128((__m128i*)hi, bitsHi);
+        _mm_storeu_si128((__m128i*)lo, bitsLo);
+        _mm_storeu_si128((__m128i*)valid, ok);
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i greater8(const __m256i a, const __m256i b) {
+        const __m256i bias = _mm256_set1_epi32(0x80000000);
+        return _mm256_cmpgt_epi32(_mm256_xor_si256(a, bias), _mm256_xor_si256(b, bias));
+    }
+
+    __attribute__((target("avx2")))
+    static inline void classify8(const __m256i p1, const __m256i p2, const timingProfile &tp, const bool lastBit,
+                                 __m256i &valid, __m256i &one) {
+        const __m256i fixedPw = _mm256_set1_epi32(tp.fixedPw), shortPw = _mm256_set1_epi32(tp.shortPw);
+        const __m256i longPw = _mm256_set1_epi32(tp.longPw), tolerance = _mm256_set1_epi32(tp.tolerance);
+        if (!lastBit) {
+            const __m256i above = greater8(p2, fixedPw);
+            const __m256i diff = _mm256_blendv_epi8(_mm256_sub_epi32(fixedPw, p2), _mm256_sub_epi32(p2, fixedPw), above);
+            valid = _mm256_andnot_si256(greater8(diff, tolerance), valid);
+        }
+        const __m256i belowShort = greater8(shortPw, p1);
+        const __m256i aboveLong = greater8(p1, longPw);
+        const __m256i between = _mm256_xor_si256(_mm256_or_si256(belowShort, aboveLong), _mm256_set1_epi32(-1));
+        const __m256i shortBelow = _mm256_and_si256(belowShort, greater8(tolerance, _mm256_sub_epi32(shortPw, p1)));
+        const __m256i longAbove = _mm256_and_si256(aboveLong, greater8(tolerance, _mm256_sub_epi32(p1, longPw)));
+        const __m256i shortBetween = _mm256_and_si256(between, greater8(tolerance, _mm256_sub_epi32(p1, shortPw)));
+        const __m256i longBetween = _mm256_andnot_si256(shortBetween,
+            _mm256_and_si256(between, greater8(tolerance, _mm256_sub_epi32(longPw, p1))));
+        one = _mm256_or_si256(shortBelow, shortBetween);
+        valid = _mm256_and_si256(valid, _mm256_or_si256(one, _mm256_or_si256(longAbove, longBetween)));
+    }
+
+    __attribute__((target("avx2")))
+    static void decode8(const uint32_t *windows, const timingProfile &tp, uint32_t hi[8], uint32_t lo[8],
+                        uint32_t valid[8]) {
+        // Gathers the same timing of 8 windows
+        const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                                   _mm256_set1_epi32(TIMINGS_BUFFER_SIZE));
+        __m256i ok = _mm256_set1_epi32(-1), bitsHi = _mm256_setzero_si256(), bitsLo = _mm256_setzero_si256(), one;
+        for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+            const __m256i p1 = _mm256_i32gather_epi32((const int*)windows + 2*b, offsets, 4);
+            const __m256i p2 = _mm256_i32gather_epi32((const int*)windows + 2*b + 1, offsets, 4);
+            classify8(p1, p2, tp, b == TIMINGS_BUFFER_SIZE / 2 - 1, ok, one);
+            if (b < 22) bitsHi = _mm256_or_si256(_mm256_slli_epi32(bitsHi, 1), _mm256_srli_epi32(one, 31));
+            else bitsLo = _mm256_or_si256(_mm256_slli_epi32(bitsLo, 1), _mm256_srli_epi32(one, 31));
+        }
+        _mm256_storeu_si256((__m256i*)hi, bitsHi);
+        _mm256_storeu_si256((__m256i*)lo, bitsLo);
+        _mm256_storeu_si256((__m256i*)valid, ok);
+    }
+#endif
+
+    /**
+     * Decodes count windows into bytes[] and status[], like WS8610Receiver::decodeFrame() does for one
+     */
+    inline void decodeFrames(const uint32_t *windows, const size_t count, const timingProfile &tp,
+                             uint8_t (*bytes)[6], frameStatus *status, const kernel k = bestKernel()) {
+        size_t w = 0;
+#ifdef BATCH_DECODE_X86
+        const size_t lanes = (k == AVX2)? 8 : (k == SSE2)? 4 : 0;
+        uint32_t hi[8], lo[8], valid[8];
+        for(; lanes > 0 && w + lanes <= count; w += lanes) {
+            if (k == AVX2) decode8(windows + w * TIMINGS_BUFFER_SIZE, tp, hi, lo, valid);
+            else decode4(windows + w * TIMINGS_BUFFER_SIZE, tp, hi, lo, valid);
+            for(size_t l = 0; l < lanes; l++) {
+                if (!valid[l]) {
+                    status[w + l] = TIMINGS_MISMATCH;
+                    continue;
+                }
+                packFrame(hi[l], lo[l], bytes[w + l]);
+                status[w + l] = WS8610Receiver::checkFrame(bytes[w + l]);
+            }
+        }
+#else
+        (void)k;
+#endif
+        for(; w < count; w++) {
+            status[w] = WS8610Receiver::decodeFrame(windows + w * TIMINGS_BUFFER_SIZE, tp, bytes[w]);
+        }
+    }
+}
+
+#endif
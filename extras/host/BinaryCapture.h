@@ -0,0 +1,297 @@
+/*
+  Binary pulse captures, about 2 bytes per pulse, with a sidecar index of the packets.
+
+  Capture file (.wsc), little-endian:
+    header   char magic[4] = "WSC1"
+             uint32_t resolution    ns per duration unit, always 1000 (µs)
+             uint64_t startTime     Unix time in ms of the first pulse, 0 if unknown
+             uint64_t pulseCount
+             uint64_t durationUsec  Sum of all the pulse durations
+    body     pulse durations as LEB128 varints (7 bits per byte, high bit set on all but the last byte)
+
+  Index file (.wsi, same name as the capture), one entry for each sync signal that completes a
+  packet according to WS8610Receiver::addPulse():
+    header   char magic[4] = "WSI1"
+             uint32_t reserved
+             uint64_t count
+    entries  uint64_t usec          Time of the sync signal, from the start of the capture
+             uint64_t pulse         Index of the sync pulse
+             uint64_t offset        Body offset of the first pulse of the packet window (including
+                                    the noise pulses merged into it)
+
+  Entries are ordered by time, so a time can be found with a binary search, and a packet window is
+  rebuilt by decoding only the varints between its offset and the sync pulse.
+
+  Needs host/Arduino.h and WS8610Receiver.h to be included first.
+*/
+
+#ifndef WS8610_HOST_BINARY_CAPTURE_h
+#define WS8610_HOST_BINARY_CAPTURE_h
+
+#include "Capture.h"
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct captureHeader {
+    char magic[4];
+    uint32_t resolution;
+    uint64_t startTime;
+    uint64_t pulseCount;
+    uint64_t durationUsec;
+};
+
+struct indexEntry {
+    uint64_t usec;
+    uint64_t pulse;
+    uint64_t offset;
+};
+
+namespace capture {
+    inline std::string indexPath(const char *capturePath) {
+        std::string path(capturePath);
+        const size_t dot = path.rfind('.');
+        if (dot != std::string::npos && path.find('/', dot) == std::string::npos) path.resize(dot);
+        return path + ".wsi";
+    }
+
+    /**
+     * Writes a binary capture and its index while the pulses are added
+     */
+    class writer {
+    public:
+        writer() : data(nullptr), index(nullptr) {}
+        ~writer() { close(); }
+
+        bool open(const char *path, const uint64_t startTime = 0) {
+            data = fopen(path, "wb");
+            index = fopen(indexPath(path).c_str(), "wb");
+            if (data == nullptr || index == nullptr) {
+                close();
+                return false;
+            }
+            header = { {'W', 'S', 'C', '1'}, 1000, startTime, 0, 0 };
+            fwrite(&header, sizeof(header), 1, data);
+            const char indexMagic[8] = {'W', 'S', 'I', '1', 0, 0, 0, 0};
+            uint64_t count = 0;
+            fwrite(indexMagic, sizeof(indexMagic), 1, index);
+            fwrite(&count, sizeof(count), 1, index);
+            framer = {};
+            windowPos = 0;
+            offset = runStart = 0;
+            inNoise = false;
+            indexCount = 0;
+            return true;
+        }
+
+        void addPulse(const uint32_t duration) {
+            // The window of a packet starts with the noise pulses merged into its first pulse
+            if (!inNoise) runStart = offset;
+            inNoise = (duration < NOISE_THRESHOLD);
+            if (!inNoise) {
+                if (++windowPos == TIMINGS_BUFFER_SIZE) windowPos = 0;
+                windowStarts[windowPos] = runStart;
+            }
+
+            uint8_t bytes[5];
+            int size = 0;
+            uint32_t value = duration;
+            do {
+                bytes[size] = value & 0x7F;
+                value >>= 7;
+                if (value) bytes[size] |= 0x80;
+                size++;
+            } while(value);
+            fwrite(bytes, 1, size, data);
+            offset += size;
+            header.durationUsec += duration;
+
+            if (WS8610Receiver::addPulse(framer, duration)) {
+                // Oldest entry of the ring is the start of the first of the TIMINGS_BUFFER_SIZE pulses
+                const indexEntry entry = { header.durationUsec, header.pulseCount,
+                    windowStarts[(windowPos + 1) % TIMINGS_BUFFER_SIZE] };
+                fwrite(&entry, sizeof(entry), 1, index);
+                indexCount++;
+            }
+            header.pulseCount++;
+        }
+
+        void close() {
+            if (data != nullptr) {
+                fseek(data, 0, SEEK_SET);
+                fwrite(&header, sizeof(header), 1, data);
+                fclose(data);
+            }
+            if (index != nullptr) {
+                fseek(index, 8, SEEK_SET);
+                fwrite(&indexCount, sizeof(indexCount), 1, index);
+                fclose(index);
+            }
+            data = index = nullptr;
+        }
+
+    private:
+        FILE *data, *index;
+        captureHeader header;
+        pulseFramer framer;
+        uint64_t windowStarts[TIMINGS_BUFFER_SIZE];
+        int windowPos;
+        uint64_t offset, runStart;
+        bool inNoise;
+        uint64_t indexCount;
+    };
+
+    /**
+     * Memory maps a binary capture and its index
+     */
+    class binaryCapture {
+    public:
+        captureHeader header;
+
+        binaryCapture() : data(nullptr), dataSize(0), index(nullptr), indexSize(0), indexCount(0) {}
+        ~binaryCapture() { close(); }
+
+        bool open(const char *path) {
+            close();
+            data = (const uint8_t*)map(path, dataSize);
+            if (data == nullptr || dataSize < sizeof(header) || memcmp(data, "WSC1", 4) != 0) {
+                close();
+                return false;
+            }
+            memcpy(&header, data, sizeof(header));
+            index = (const uint8_t*)map(indexPath(path).c_str(), indexSize);
+            if (index != nullptr && (indexSize < 16 || memcmp(index, "WSI1", 4) != 0)) {
+                munmap((void*)index, indexSize);
+                index = nullptr;
+            }
+            if (index != nullptr) {
+                // Only the entries up to the first one pointing outside the body are used
+                uint64_t declared;
+                memcpy(&declared, index + 8, sizeof(declared));
+                const uint64_t count = (indexSize - 16) / sizeof(indexEntry);
+                const uint64_t limit = (declared < count)? declared : count;
+                for(indexCount = 0; indexCount < limit && packet(indexCount).offset < dataSize - sizeof(header);
+                    indexCount++);
+            }
+            return true;
+        }
+
+        void close() {
+            if (data != nullptr) munmap((void*)data, dataSize);
+            if (index != nullptr) munmap((void*)index, indexSize);
+            data = index = nullptr;
+            indexCount = 0;
+        }
+
+        bool hasIndex() const { return index != nullptr; }
+
+        uint64_t packets() const { return indexCount; }
+
+        indexEntry packet(const uint64_t p) const {
+            indexEntry entry;
+            memcpy(&entry, index + 16 + p * sizeof(indexEntry), sizeof(entry));
+            return entry;
+        }
+
+        /**
+         * First packet whose sync signal comes at or after usec
+         */
+        uint64_t findPacket(const uint64_t usec) const {
+            uint64_t low = 0, high = packets();
+            while(low < high) {
+                const uint64_t mid = (low + high) / 2;
+                if (packet(mid).usec < usec) low = mid + 1;
+                else high = mid;
+            }
+            return low;
+        }
+
+        /**
+         * Rebuilds the timings of a packet, as the interrupt handler would have buffered them.
+         * Returns false, with the timings cleared, if the capture ends before the packet is complete
+         */
+        bool packetTimings(const uint64_t p, uint32_t timings[TIMINGS_BUFFER_SIZE]) const {
+            const indexEntry entry = packet(p);
+            pulseFramer framer = {};
+            framer.lastSync = 1;
+            const uint8_t *pos = data + sizeof(header) + entry.offset, *end = data + dataSize;
+            uint32_t duration;
+            do {
+                if (!readVarint(pos, end, duration)) {
+                    memset(timings, 0, TIMINGS_BUFFER_SIZE * sizeof(timings[0]));
+                    return false;
+                }
+            } while(!WS8610Receiver::addPulse(framer, duration));
+            WS8610Receiver::copyTimings(framer, timings);
+            return true;
+        }
+
+        /**
+         * Calls onPulse(duration) for each pulse of the body, stopping early if it is truncated.
+         * Returns the number of pulses read
+         */
+        template<typename F>
+        uint64_t forEachPulse(F onPulse) const {
+            const uint8_t *pos = data + sizeof(header), *end = data + dataSize;
+            uint64_t p = 0;
+            uint32_t duration;
+            for(; p < header.pulseCount && readVarint(pos, end, duration); p++) onPulse(duration);
+            return p;
+        }
+
+    private:
+        const uint8_t *data;
+        size_t dataSize;
+        const uint8_t *index;
+        size_t indexSize;
+        uint64_t indexCount;
+
+        static const void* map(const char *path, size_t &size) {
+            const int fd = ::open(path, O_RDONLY);
+            if (fd < 0) return nullptr;
+            struct stat st;
+            void *mapped = nullptr;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                size = st.st_size;
+                mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED) mapped = nullptr;
+            }
+            ::close(fd);
+            return mapped;
+        }
+
+        /**
+         * Reads a duration of at most 5 bytes, without going past end.
+         * Returns false if the varint is cut by end or too long
+         */
+        static bool readVarint(const uint8_t *&pos, const uint8_t *end, uint32_t &value) {
+            value = 0;
+            for(int shift = 0; shift < 35 && pos < end; shift += 7) {
+                const uint8_t byte = *pos++;
+                value |= (uint32_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+    };
+
+    /**
+     * Reads a binary, raw device stream, rtl_433 or text capture calling onPulse(duration) for each pulse.
+     * Returns the number of pulses read or -1 if the file can't be opened
+     */
+    template<typename F>
+    long read(const char *path, F onPulse) {
+        binaryCapture binary;
+        if (binary.open(path)) {
+            return binary.forEachPulse(onPulse);
+        }
+        if (isRawStream(path)) return readRawStream(path, onPulse);
+        return isOok(path)? readOok(path, onPulse) : readText(path, onPulse);
+    }
+}
+
+#endif
@@ -0,0 +1,211 @@
+/*
+  Readers for raw pulse captures, used by the host tools.
+
+  Text capture format: pulse durations in µs (the time between two level changes of the
+  data pin), separated by spaces or new lines. Lines starting with '#' are comments.
+    # site=garage receiver=RXB6
+    1030 560 1030 1370
+    ...
+
+  rtl_433 pulse data (rtl_433 -w file.ook): packages of "pulse gap" lines, with ';' comments.
+    ;pulse data
+    ;version 1
+    ;timescale 1us
+    ;ook 88 pulses
+    ;freq1 433920000
+    560 1030
+    1370 1030
+    ...
+    ;end
+  Each line gives the two durations between three level changes. FSK packages are skipped.
+
+  Raw device stream (.wsr): the bytes sent by a receiver built with WS8610_RAW_CAPTURE, see
+  WS8610Receiver::readRawBytes(). Pulse durations have a 4 µs resolution.
+*/
+
+#ifndef WS8610_HOST_CAPTURE_h
+#define WS8610_HOST_CAPTURE_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OOK_PACKAGE_GAP 20000 // Min silence after an rtl_433 package (µs)
+#define RAW_STREAM_RESOLUTION 4 // µs, RAW_RESOLUTION of the receiver
+#define RAW_STREAM_LOST_GAP 20000 // µs, silence standing for the bytes skipped in a stream (longer than a sync)
+
+namespace capture {
+    /**
+     * Reads a text capture calling onPulse(duration) for each pulse.
+     * Returns the number of pulses read or -1 if the file can't be opened
+     */
+    template<typename F>
+    long readText(const char *path, F onPulse) {
+        FILE *f = (path[0] == '-' && path[1] == 0)? stdin : fopen(path, "r");
+        if (f == nullptr) return -1;
+        long pulses = 0;
+        uint32_t value = 0;
+        bool inNumber = false, inComment = false;
+        int c;
+        while((c = getc(f)) != EOF) {
+            if (inComment) {
+                if (c == '\n') inComment = false;
+                continue;
+            }
+            if (isdigit(c)) {
+                value = value * 10 + (c - '0');
+                inNumber = true;
+                continue;
+            }
+            if (inNumber) {
+                onPulse(value);
+                pulses++;
+                value = 0;
+                inNumber = false;
+            }
+            if (c == '#') inComment = true;
+        }
+        if (inNumber) {
+            onPulse(value);
+            pulses++;
+        }
+        if (f != stdin) fclose(f);
+        return pulses;
+    }
+
+    /**
+     * True if the file starts like rtl_433 pulse data
+     */
+    inline bool isOok(const char *path) {
+        const size_t length = strlen(path);
+        if (length > 4 && strcmp(path + length - 4, ".ook") == 0) return true;
+        FILE *f = fopen(path, "r");
+        if (f == nullptr) return false;
+        char line[16] = {0};
+        const bool ook = (fgets(line, sizeof(line), f) != nullptr && strncmp(line, ";pulse data", 11) == 0);
+        fclose(f);
+        return ook;
+    }
+
+    /**
+     * Reads an rtl_433 pulse data file calling onPulse(duration) for each pulse, one line at a time.
+     * rtl_433 ends a package once the gap exceeds its reset limit, so the last gap of a package is
+     * only a lower bound of the silence: it's stretched to OOK_PACKAGE_GAP, which is also long
+     * enough to be a sync signal for the receiver. The same silence is added before the first package.
+     * Returns the number of pulses read or -1 if the file can't be opened
+     */
+    template<typename F>
+    long readOok(const char *path, F onPulse) {
+        FILE *f = (path[0] == '-' && path[1] == 0)? stdin : fopen(path, "r");
+        if (f == nullptr) return -1;
+        long pulses = 0;
+        double scale = 1;   // µs per unit
+        bool skip = false;  // Inside an FSK package
+        uint32_t lastGap = OOK_PACKAGE_GAP;
+        char line[256];
+        while(fgets(line, sizeof(line), f) != nullptr) {
+            if (line[0] == ';') {
+                char unit[8] = {0};
+                double value;
+                if (sscanf(line, ";timescale %lf%7s", &value, unit) == 2) {
+                    scale = (strcmp(unit, "ns") == 0)? value / 1000 : (strcmp(unit, "ms") == 0)? value * 1000 : value;
+                }
+                else if (strncmp(line, ";ook", 4) == 0) skip = false;
+                else if (strncmp(line, ";fsk", 4) == 0) skip = true;
+                else if (strncmp(line, ";end", 4) == 0 && pulses > 0 && lastGap > 0) {
+                    onPulse((lastGap > OOK_PACKAGE_GAP)? lastGap : OOK_PACKAGE_GAP);
+                    pulses++;
+                    lastGap = 0;
+                }
+                continue;
+            }
+            char *next;
+            const unsigned long pulse = strtoul(line, &next, 10);
+            if (next == line || skip) continue;
+            const unsigned long gap = strtoul(next, nullptr, 10);
+            // The gap of a line is sent with the next pulse, to know if it ends the package
+            if (lastGap > 0) {
+                onPulse(lastGap);
+                pulses++;
+            }
+            onPulse((uint32_t)(pulse * scale + 0.5));
+            pulses++;
+            lastGap = (uint32_t)(gap * scale + 0.5);
+        }
+        if (pulses > 0 && lastGap > 0) {
+            onPulse((lastGap > OOK_PACKAGE_GAP)? lastGap : OOK_PACKAGE_GAP);
+            pulses++;
+        }
+        if (f != stdin) fclose(f);
+        return pulses;
+    }
+
+    inline bool isRawStream(const char *path) {
+        const size_t length = strlen(path);
+        return length > 4 && strcmp(path + length - 4, ".wsr") == 0;
+    }
+
+    /**
+     * Reads a raw device stream calling onPulse(duration) for each pulse. Bytes before the first sync
+     * marker are skipped (the stream may have been joined at any point). The device marks the pulses it
+     * dropped with a long silence where they were; bytes skipped after a corrupted varint are replaced
+     * by a silence of RAW_STREAM_LOST_GAP, so the packet cut by the loss isn't joined with the pulses
+     * after it. The number of pulses the device dropped while the stream was read is stored in dropped
+     * (the marker giving it comes before the pulses buffered ahead of the loss, so it can't place it).
+     * Returns the number of pulses read or -1 if the file can't be opened
+     */
+    template<typename F>
+    long readRawStream(const char *path, F onPulse, uint32_t *dropped = nullptr) {
+        FILE *f = (path[0] == '-' && path[1] == 0)? stdin : fopen(path, "rb");
+        if (f == nullptr) return -1;
+        if (dropped != nullptr) *dropped = 0;
+        long pulses = 0;
+        bool synced = false, known = false, lost = false;
+        uint32_t lastDropped = 0; // Total of the device at the previous marker
+        int field = -1;  // Marker field being read, -1 for pulses
+        uint32_t value = 0;
+        int shift = 0, c;
+        while((c = getc(f)) != EOF) {
+            if (c == 0) { // Sync marker
+                synced = true;
+                field = 0;
+                value = shift = 0;
+                continue;
+            }
+            if (!synced) continue;
+            value |= (uint32_t)(c & 0x7F) << shift;
+            shift += 7;
+            if (c & 0x80) {
+                if (shift > 28) { // Corrupted varint, waits for the next marker
+                    synced = false;
+                    lost = true;
+                }
+                continue;
+            }
+            if (field < 0) {
+                onPulse((value - 1) * RAW_STREAM_RESOLUTION);
+                pulses++;
+            }
+            else if (++field == 2) {
+                // The device sends its total modulo 2^31
+                const uint32_t total = (value - 1) & 0x7FFFFFFF;
+                if (known && dropped != nullptr) *dropped += (total - lastDropped) & 0x7FFFFFFF;
+                if (lost) {
+                    onPulse(RAW_STREAM_LOST_GAP);
+                    pulses++;
+                }
+                lastDropped = total;
+                known = true;
+                lost = false;
+                field = -1;
+            }
+            value = shift = 0;
+        }
+        if (f != stdin) fclose(f);
+        return pulses;
+    }
+}
+
+#endif
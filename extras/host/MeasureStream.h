@@ -0,0 +1,56 @@
+/*
+  Decoder of the binary measure frames sent by WS8610Output (see WS8610Output.h for the format).
+  Bytes can be added as they come from the serial port: a stream joined in the middle of a frame
+  only loses that frame.
+
+  Needs WS8610Output.h to be included first.
+*/
+
+#ifndef WS8610_HOST_MEASURE_STREAM_h
+#define WS8610_HOST_MEASURE_STREAM_h
+
+#include <stdint.h>
+
+namespace output {
+    class measureDecoder {
+    public:
+        long frames;    // Frames decoded
+        long bad;       // Frames with a wrong size, invalid COBS or CRC mismatch
+
+        measureDecoder() : frames(0), bad(0), length(0) {}
+
+        /**
+         * Adds a byte of the stream, calling onMeasure(const measure&) when it completes a valid frame
+         */
+        template<typename F>
+        void addByte(const uint8_t byte, F onMeasure) {
+            if (byte != 0) {
+                // Longer frames are bad anyway, keeps just the count
+                if (length < (int)sizeof(frame)) frame[length] = byte;
+                length++;
+                return;
+            }
+            if (length == 0) return; // Delimiter of a frame lost before
+            uint8_t record[sizeof(frame)];
+            measure m;
+            if (length == OUTPUT_FRAME_SIZE - 1 &&
+                cobsDecode(frame, length, record) == OUTPUT_RECORD_SIZE && decodeMeasureRecord(record, m)) {
+                frames++;
+                onMeasure(m);
+            }
+            else bad++;
+            length = 0;
+        }
+
+        template<typename F>
+        void addBytes(const uint8_t *bytes, const size_t count, F onMeasure) {
+            for(size_t b = 0; b < count; b++) addByte(bytes[b], onMeasure);
+        }
+
+    private:
+        uint8_t frame[OUTPUT_FRAME_SIZE];
+        int length;
+    };
+}
+
+#endif
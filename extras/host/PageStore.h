@@ -0,0 +1,76 @@
+/*
+  Flash-like page storage for WS8610History on a host computer: erased pages read as 0xFF and
+  writes can only clear bits, as on NOR flash. Pages are kept in memory, or in a file if a path is
+  given (loaded when opened, saved by save() and when closed).
+
+  Counts the erases of each page, to check the wear levelling, and the writes that tried to set a
+  bit, which a real flash would have ignored.
+*/
+
+#ifndef WS8610_HOST_PAGE_STORE_h
+#define WS8610_HOST_PAGE_STORE_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace host {
+    class pageStore {
+    public:
+        uint32_t badWrites;     // Writes that would have set a bit
+
+        pageStore(const uint16_t size, const uint16_t count, const char *path = nullptr)
+            : badWrites(0), size(size), count(count), bytes((size_t)size * count, 0xFF), erases(count, 0) {
+            if (path == nullptr) return;
+            this->path = path;
+            FILE *f = fopen(path, "rb");
+            if (f == nullptr) return;
+            if (fread(bytes.data(), 1, bytes.size(), f) != bytes.size()) bytes.assign(bytes.size(), 0xFF);
+            fclose(f);
+        }
+        ~pageStore() { save(); }
+
+        uint16_t pageSize() const { return size; }
+        uint16_t pageCount() const { return count; }
+
+        void read(uint16_t page, uint16_t offset, uint8_t *data, uint16_t length) {
+            for(uint16_t b = 0; b < length; b++) data[b] = bytes[at(page, offset + b)];
+        }
+
+        void write(uint16_t page, uint16_t offset, const uint8_t *data, uint16_t length) {
+            for(uint16_t b = 0; b < length; b++) {
+                uint8_t &byte = bytes[at(page, offset + b)];
+                if (data[b] & ~byte) badWrites++;
+                byte &= data[b];
+            }
+        }
+
+        void erase(uint16_t page) {
+            for(uint16_t b = 0; b < size; b++) bytes[at(page, b)] = 0xFF;
+            erases[page]++;
+        }
+
+        uint32_t pageErases(const uint16_t page) const { return erases[page]; }
+
+        bool save() const {
+            if (path.empty()) return true;
+            FILE *f = fopen(path.c_str(), "wb");
+            if (f == nullptr) return false;
+            const bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+            return (fclose(f) == 0) && ok;
+        }
+
+    private:
+        uint16_t size, count;
+        std::string path;
+        std::vector<uint8_t> bytes;
+        std::vector<uint32_t> erases;
+
+        size_t at(const uint16_t page, const uint32_t offset) const {
+            return (size_t)page * size + offset;
+        }
+    };
+}
+
+#endif
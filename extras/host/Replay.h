@@ -0,0 +1,28 @@
+/*
+  Replays pulses through a WS8610Receiver on the host, collecting the decoded measures.
+  Needs host/Arduino.h and WS8610Receiver.h to be included first.
+*/
+
+#ifndef WS8610_HOST_REPLAY_h
+#define WS8610_HOST_REPLAY_h
+
+namespace host {
+    /**
+     * Decodes the pending packets and passes the resulting measures to onMeasure(const measure&).
+     * Called after every pulse, so the receiver buffers never overflow during a replay
+     */
+    template<typename F>
+    void drain(WS8610Receiver &receiver, F onMeasure) {
+        for(int n = receiver.receivedMeasures(); n > 0; n--) onMeasure(receiver.getNextMeasure());
+    }
+
+    template<typename F>
+    void replay(WS8610Receiver &receiver, const uint32_t *pulses, const size_t count, F onMeasure) {
+        for(size_t p = 0; p < count; p++) {
+            host::pulse(pulses[p]);
+            drain(receiver, onMeasure);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*
+  Converts sampled 0/1 levels of the data pin (logic analyzers, thresholded SDR envelope) into the
+  pulse durations that the interrupt handler would measure on the board.
+
+  Samples are processed 64 at a time: the edges of a word are the set bits of
+  word ^ (word << 1 | previous sample), found with count-trailing-zeros, so runs without edges
+  cost one operation every 64 samples. Short glitches are not removed here: like on the board,
+  they are merged by the NOISE_THRESHOLD filter of WS8610Receiver::addPulse().
+*/
+
+#ifndef WS8610_HOST_SAMPLE_STREAM_h
+#define WS8610_HOST_SAMPLE_STREAM_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace capture {
+    class edgeDetector {
+    public:
+        edgeDetector(const uint32_t sampleRate) : rate(sampleRate), sample(0), lastEdgeUsec(0), level(0) {}
+
+        /**
+         * Adds count words of 64 samples each, first sample in the least significant bit.
+         * Calls onPulse(duration) with the µs between two edges
+         */
+        template<typename F>
+        void addWords(const uint64_t *words, const size_t count, F onPulse) {
+            for(size_t w = 0; w < count; w++) {
+                uint64_t edges = words[w] ^ ((words[w] << 1) | level);
+                level = words[w] >> 63;
+                while(edges) {
+                    edge(sample + __builtin_ctzll(edges), onPulse);
+                    edges &= edges - 1;
+                }
+                sample += 64;
+            }
+        }
+
+        /**
+         * Adds count samples stored one per byte, taking the level from bit "channel" of each byte.
+         * count must be a multiple of 64, except for the last block
+         */
+        template<typename F>
+        void addBytes(const uint8_t *samples, const size_t count, const int channel, F onPulse) {
+            uint64_t word;
+            size_t s = 0;
+            for(; s + 64 <= count; s += 64) {
+                word = 0;
+                for(int b = 0; b < 8; b++) word |= (uint64_t)gather8(samples + s + 8 * b, channel) << (8 * b);
+                addWords(&word, 1, onPulse);
+            }
+            if (s < count) addTail(samples + s, count - s, channel, onPulse);
+        }
+
+        /**
+         * Adds the last samples of a stream, when they are not a whole word
+         */
+        template<typename F>
+        void addTail(const uint8_t *samples, const size_t count, const int channel, F onPulse) {
+            for(size_t s = 0; s < count; s++) {
+                const uint64_t bit = (samples[s] >> channel) & 1;
+                if (bit != level) edge(sample, onPulse);
+                level = bit;
+                sample++;
+            }
+        }
+
+        uint64_t samples() const { return sample; }
+
+    private:
+        uint32_t rate;
+        uint64_t sample;       // Index of the next sample
+        uint64_t lastEdgeUsec;
+        uint64_t level;        // Level of the last sample
+
+        uint64_t usec(const uint64_t s) const {
+            return (s / rate) * 1000000 + (s % rate) * 1000000 / rate;
+        }
+
+        template<typename F>
+        void edge(const uint64_t s, F &onPulse) {
+            const uint64_t now = usec(s);
+            // An edge on the very first sample only starts the first pulse
+            if (s > 0) onPulse((uint32_t)(now - lastEdgeUsec));
+            lastEdgeUsec = now;
+        }
+
+        // Bit "channel" of 8 consecutive bytes, packed in a byte with a multiply
+        static uint8_t gather8(const uint8_t *p, const int channel) {
+            uint64_t x;
+            memcpy(&x, p, 8);  // Little endian host
+            x = (x >> channel) & 0x0101010101010101ULL;
+            return (x * 0x0102040810204080ULL) >> 56;
+        }
+    };
+}
+
+#endif
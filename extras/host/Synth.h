@@ -0,0 +1,296 @@
+/*
+  Synthetic LaCrosse traffic: encodes measures into frames, as WS8610Receiver::decodePacket()
+  expects them, and renders the transmissions of N sensors as the pulses seen on the data pin.
+
+  Every sensor transmits every ~57 s (each one with its own period, so sensors drift in and out of
+  collisions) a temperature frame, its repeat and a humidity frame, separated by FRAME_GAP µs.
+  Impairments:
+    jitter    each high and low pulse of a frame is moved by up to +/- jitter µs
+    glitches  a pulse is split by a noise glitch shorter than NOISE_THRESHOLD
+    dropouts  the signal of a frame is lost for dropoutUsec µs
+    overlaps  transmissions starting before the previous one has ended are OR-ed together
+
+  Every sent frame is reported with the flags of the impairments it suffered (ground truth).
+  Needs host/Arduino.h and WS8610Receiver.h to be included first.
+*/
+
+#ifndef WS8610_HOST_SYNTH_h
+#define WS8610_HOST_SYNTH_h
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#define SYNTH_PERIOD 57000000 // Nominal transmission period (µs)
+#define SYNTH_PERIOD_SPREAD 500000 // Max distance of the period of a sensor from the nominal one
+#define FRAME_GAP 30000       // Silence between the frames of a transmission (µs)
+
+enum sentFlags : uint8_t {SENT_COLLIDED = 1, SENT_DROPOUT = 2};
+
+struct sentFrame {
+    uint64_t usec;      // Start of the frame
+    uint8_t sensorAddr;
+    measureType type;
+    int16_t tenths;
+    uint8_t flags;      // sentFlags
+};
+
+namespace synth {
+    // xorshift64*, fast and good enough for noise
+    class rng {
+    public:
+        rng(const uint64_t seed) : state(seed? seed : 0x9E3779B97F4A7C15ULL) {}
+
+        uint64_t next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1DULL;
+        }
+
+        // Uniform in [0, n)
+        uint32_t below(const uint32_t n) { return (uint32_t)(((next() >> 32) * n) >> 32); }
+
+        // Uniform in [-n, n]
+        int32_t around(const uint32_t n) { return (int32_t)below(2 * n + 1) - (int32_t)n; }
+
+        // True with the probability given by threshold / 2^32, see chance()
+        bool hit(const uint32_t threshold) { return (uint32_t)next() < threshold; }
+
+        static uint32_t chance(const double p) {
+            return (p <= 0)? 0 : (p >= 1)? 0xFFFFFFFF : (uint32_t)(p * 4294967296.0);
+        }
+
+    private:
+        uint64_t state;
+    };
+
+    /**
+     * Encodes a measure (in tenths, see measureTenths()) into the six bytes of a frame, with the start
+     * sequence, parity bit and checksum checked by WS8610Receiver::checkFrame()
+     */
+    inline void encodeFrame(const uint8_t sensorAddr, const measureType type, const int16_t tenths, uint8_t bytes[6]) {
+        // Temperature is sent with a +50 °C offset
+        const int raw = (type == TEMPERATURE)? tenths + 500 : tenths;
+        const uint8_t tens = (raw / 100) % 10, ones = (raw / 10) % 10, decimals = raw % 10;
+        bytes[0] = 0x0A;
+        bytes[1] = ((type == HUMIDITY)? 0xE0 : 0x00) | ((sensorAddr >> 3) & 0xF);
+        bytes[2] = ((sensorAddr & 7) << 5) | tens;
+        bytes[3] = (ones << 4) | decimals;
+        bytes[4] = (tens << 4) | ones;
+        // Parity bit #19 makes the data bits even
+        uint8_t bits = (bytes[2] & 0x1F) ^ bytes[3];
+        bits ^= bits >> 4;
+        bits ^= bits >> 2;
+        bits ^= bits >> 1;
+        if (bits & 1) bytes[2] |= 0x10;
+        uint8_t checksum = 0;
+        for(int b = 0; b < 5; b++) checksum += (bytes[b] & 0xF) + (bytes[b] >> 4);
+        bytes[5] = checksum & 0xF;
+    }
+
+    /**
+     * Bit b of a frame, in the order it is sent
+     */
+    inline int frameBit(const uint8_t bytes[6], const int b) {
+        return (b < 40)? (bytes[b / 8] >> (7 - b % 8)) & 1 : (bytes[5] >> (43 - b)) & 1;
+    }
+
+    /**
+     * Renders a frame with exact pulse widths into the timings buffered by the receiver, ending with syncGap
+     */
+    inline void frameTimings(const uint8_t bytes[6], const timingProfile &tp, const uint32_t syncGap,
+                             uint32_t timings[TIMINGS_BUFFER_SIZE]) {
+        for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+            timings[2*b] = frameBit(bytes, b)? tp.shortPw : tp.longPw;
+            timings[2*b + 1] = tp.fixedPw;
+        }
+        timings[TIMINGS_BUFFER_SIZE - 1] = syncGap;
+    }
+
+    struct impairments {
+        uint32_t jitter;      // µs
+        double glitchRate;    // Probability of a glitch in each pulse
+        double dropoutRate;   // Probability of a dropout in each frame
+        uint32_t dropoutUsec;
+    };
+
+    class generator {
+    public:
+        generator(const int sensorCount, const uint64_t seed, const impairments &imp,
+                  const timingProfile &tp = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE })
+            : random(seed), imp(imp), timing(tp), glitchThreshold(rng::chance(imp.glitchRate)),
+              dropoutThreshold(rng::chance(imp.dropoutRate)), now(0), lastEdge(0), clusterEnd(0), transmissions(0), overlapped(false) {
+            bool used[128] = {false};
+            for(int s = 0; s < sensorCount && s < 128; s++) {
+                sensor sn;
+                do sn.addr = random.below(128); while(used[sn.addr]);
+                used[sn.addr] = true;
+                sn.period = SYNTH_PERIOD + random.around(SYNTH_PERIOD_SPREAD);
+                sn.next = random.below(sn.period);
+                sn.temperature = 200 + random.around(150);
+                sn.humidity = 300 + 10 * random.below(50);
+                sensors.push_back(sn);
+            }
+            highs.reserve(1024);
+        }
+
+        /**
+         * Generates the traffic of the next durationUsec µs, calling onPulse(uint32_t duration) for each
+         * pulse and onFrame(const sentFrame&) for each frame sent. Frames are reported when their
+         * cluster of overlapping transmissions is complete, so their order follows the pulses.
+         * The silence after the last transmission ends with the first pulse of the next run, so
+         * the last frame needs one more pulse (longer than the sync) to be completed
+         */
+        template<typename F, typename G>
+        void run(const uint64_t durationUsec, F onPulse, G onFrame) {
+            const uint64_t end = now + durationUsec;
+            for(;;) {
+                sensor *sn = nullptr;
+                for(size_t s = 0; s < sensors.size(); s++) {
+                    if (sn == nullptr || sensors[s].next < sn->next) sn = &sensors[s];
+                }
+                // A transmission overlapping the current cluster joins it, otherwise the cluster is complete
+                if (sn == nullptr || sn->next >= clusterEnd) flush(onPulse, onFrame);
+                if (sn == nullptr || sn->next >= end) break;
+                transmit(*sn);
+            }
+            now = end;
+        }
+
+        uint64_t sentTransmissions() const { return transmissions; }
+
+    private:
+        struct sensor {
+            uint8_t addr;
+            uint32_t period;
+            uint64_t next;      // Start of the next transmission
+            int16_t temperature;
+            int16_t humidity;
+        };
+        struct interval {
+            uint64_t start, end;
+            bool operator<(const interval &i) const { return start < i.start; }
+        };
+        struct clusterFrame {
+            sentFrame frame;
+            uint64_t end;       // Including the gap after the frame
+            uint64_t transmission;
+        };
+
+        rng random;
+        impairments imp;
+        timingProfile timing;
+        uint32_t glitchThreshold, dropoutThreshold;
+        std::vector<sensor> sensors;
+        std::vector<interval> highs;        // High level intervals of the current cluster
+        std::vector<clusterFrame> frames;   // Frames of the current cluster
+        uint64_t now;           // End of the generated time
+        uint64_t lastEdge;
+        uint64_t clusterEnd;
+        uint64_t transmissions;
+        bool overlapped;
+
+        void transmit(sensor &sn) {
+            if (!frames.empty()) overlapped = true;
+            uint64_t t = sn.next;
+            // Values drift slowly between transmissions
+            sn.temperature = std::min(450, std::max(-300, sn.temperature + random.around(3)));
+            sn.humidity = std::min(950, std::max(150, sn.humidity + 10 * random.around(1)));
+            t = frame(sn.addr, TEMPERATURE, sn.temperature, t);
+            t = frame(sn.addr, TEMPERATURE, sn.temperature, t);
+            t = frame(sn.addr, HUMIDITY, sn.humidity, t);
+            if (t > clusterEnd) clusterEnd = t;
+            sn.next += sn.period;
+            transmissions++;
+        }
+
+        uint64_t frame(const uint8_t addr, const measureType type, const int16_t tenths, uint64_t t) {
+            clusterFrame cf = { { t, addr, type, tenths, 0 }, 0, transmissions };
+            uint8_t bytes[6];
+            encodeFrame(addr, type, tenths, bytes);
+            const size_t first = highs.size();
+            for(int b = 0; b < TIMINGS_BUFFER_SIZE / 2; b++) {
+                const uint32_t high = jittered(frameBit(bytes, b)? timing.shortPw : timing.longPw);
+                highs.push_back({ t, t + high });
+                t += high;
+                t += (b < TIMINGS_BUFFER_SIZE / 2 - 1)? jittered(timing.fixedPw) : FRAME_GAP;
+            }
+            cf.end = t;
+            if (dropoutThreshold > 0 && random.hit(dropoutThreshold)) {
+                // Signal lost: highs inside the dropout are removed, the ones across its limits are cut
+                const uint64_t from = cf.frame.usec + random.below((uint32_t)(t - cf.frame.usec));
+                const uint64_t to = from + imp.dropoutUsec;
+                size_t kept = first;
+                for(size_t h = first; h < highs.size(); h++) {
+                    interval i = highs[h];
+                    if (i.start >= from && i.end <= to) continue;
+                    if (i.start < from && i.end > from) i.end = from;
+                    else if (i.start < to && i.end > to) i.start = to;
+                    highs[kept++] = i;
+                }
+                highs.resize(kept);
+                cf.frame.flags |= SENT_DROPOUT;
+            }
+            frames.push_back(cf);
+            return t;
+        }
+
+        uint32_t jittered(const uint32_t width) {
+            const int32_t w = (int32_t)width + random.around(imp.jitter);
+            return (w > 1)? w : 1;
+        }
+
+        template<typename F>
+        void emit(uint32_t duration, F &onPulse) {
+            if (glitchThreshold > 0 && duration > 2 * NOISE_THRESHOLD && random.hit(glitchThreshold)) {
+                // The glitch splits the pulse in two, keeping its total duration
+                const uint32_t glitch = 10 + random.below(NOISE_THRESHOLD - 10);
+                const uint32_t before = 1 + random.below(duration - glitch - 1);
+                onPulse(before);
+                onPulse(glitch);
+                duration -= before + glitch;
+            }
+            onPulse(duration);
+        }
+
+        template<typename F, typename G>
+        void flush(F &onPulse, G &onFrame) {
+            if (frames.empty()) return;
+            if (overlapped) {
+                overlapped = false;
+                std::sort(highs.begin(), highs.end());
+                // Frames of different transmissions whose time spans intersect have collided
+                for(size_t a = 0; a < frames.size(); a++) {
+                    for(size_t b = a + 1; b < frames.size(); b++) {
+                        if (frames[a].transmission == frames[b].transmission) continue;
+                        if (frames[a].frame.usec < frames[b].end && frames[b].frame.usec < frames[a].end) {
+                            frames[a].frame.flags |= SENT_COLLIDED;
+                            frames[b].frame.flags |= SENT_COLLIDED;
+                        }
+                    }
+                }
+            }
+            // Union of the high intervals: an edge is emitted only where the OR of the signals changes
+            uint64_t start = highs.empty()? 0 : highs[0].start, stop = highs.empty()? 0 : highs[0].end;
+            for(size_t h = 1; h <= highs.size() && !highs.empty(); h++) {
+                if (h < highs.size() && highs[h].start <= stop) {
+                    if (highs[h].end > stop) stop = highs[h].end;
+                    continue;
+                }
+                emit((uint32_t)(start - lastEdge), onPulse);
+                emit((uint32_t)(stop - start), onPulse);
+                lastEdge = stop;
+                if (h < highs.size()) {
+                    start = highs[h].start;
+                    stop = highs[h].end;
+                }
+            }
+            for(size_t f = 0; f < frames.size(); f++) onFrame(frames[f].frame);
+            highs.clear();
+            frames.clear();
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+  Runs the pin change interrupt handler on a thread of its own, so that the receiver can be
+  drained concurrently by the main thread as it happens on the board.
+
+  Needs WS8610_HOST_THREADS to be defined before including host/Arduino.h: every pulse then runs
+  the handler holding host::interruptLock(), and noInterrupts()/interrupts() of the main thread
+  take that lock, so the handler never runs inside them. Everything else the two threads share
+  is in the receiver, so under ThreadSanitizer (-fsanitize=thread) the only races reported are the
+  ones between the handler and the code reading its packets outside noInterrupts().
+*/
+
+#ifndef WS8610_HOST_THREADED_ISR_h
+#define WS8610_HOST_THREADED_ISR_h
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace host {
+    class isrThread {
+    public:
+        isrThread() : finished(true), injected(0) {}
+        ~isrThread() { join(); }
+
+        /**
+         * Starts injecting the pulses given by source(uint32_t &duration), until it returns false.
+         * speed is the simulated time per real time (1 for real time), 0 runs as fast as possible
+         */
+        template<typename F>
+        void start(F source, const double speed) {
+            join();
+            finished = false;
+            injected = 0;
+            thread = std::thread([this, source, speed]() mutable {
+                const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+                uint64_t simulated = 0;
+                uint32_t duration;
+                while(source(duration)) {
+                    simulated += duration;
+                    if (speed > 0) {
+                        // Sleeps only when ahead by at least 1 ms, so fast rates are kept in bursts
+                        const std::chrono::steady_clock::time_point due =
+                            begin + std::chrono::microseconds((uint64_t)(simulated / speed));
+                        if (due - std::chrono::steady_clock::now() > std::chrono::milliseconds(1)) {
+                            std::this_thread::sleep_until(due);
+                        }
+                    }
+                    host::pulse(duration);
+                    injected++;
+                }
+                finished = true;
+            });
+        }
+
+        bool running() const { return !finished; }
+
+        void join() {
+            if (thread.joinable()) thread.join();
+        }
+
+        uint64_t pulses() const { return injected; }
+
+    private:
+        std::thread thread;
+        std::atomic<bool> finished;
+        std::atomic<uint64_t> injected;
+    };
+}
+
+#endif
@@ -0,0 +1,243 @@
+/*
+  Decodes many captures (or a single huge one) using all the CPU cores, and prints the
+  measures grouped by sensor and ordered by time.
+
+  Each capture is streamed by a task which splits it at sync signals in chunks of about
+  CHUNK_PULSES pulses, then every chunk is decoded by a separate task. At most MAX_QUEUED_CHUNKS
+  chunks wait to be decoded, so memory doesn't grow with the capture size. Binary captures with
+  an index are not scanned: their packets are split in chunks of CHUNK_PACKETS and each
+  task decodes just the windows listed in the index, with the SIMD kernels of BatchDecode.h. Tasks are run by a
+  work-stealing pool: each thread takes the most recent task from its own queue and, when
+  that is empty, steals the oldest task from another thread.
+
+  Build: g++ -std=c++11 -O2 -pthread -I extras/host -I . extras/tools/batch_decode.cpp -o batch_decode
+  Usage: batch_decode [-j threads] [-t tolerance] capture.txt [more captures...]
+  Captures can be text, binary (.wsc) or rtl_433 pulse data (.ook) files.
+  Captures are considered in the given order, times are relative to the start of each capture.
+  Output (CSV): sensor,capture,msec,type,value
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BinaryCapture.h"
+#include "BatchDecode.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define CHUNK_PULSES 65536
+#define CHUNK_PACKETS 1024
+#define MAX_QUEUED_CHUNKS 64  // Chunks read and not decoded yet
+
+class workPool {
+public:
+    workPool(const int threads) : queues(threads), pending(0) {}
+
+    // Adds a task to the queue of a thread (from inside a task, use the current thread)
+    void push(const int thread, std::function<void(int)> task) {
+        pending++;
+        std::lock_guard<std::mutex> lock(queues[thread].mutex);
+        queues[thread].tasks.push_back(std::move(task));
+    }
+
+    // Runs one task from inside another one, returns false if there are none
+    bool runOne(const int thread) {
+        std::function<void(int)> task;
+        if (!take(thread, task)) return false;
+        task(thread);
+        pending--;
+        return true;
+    }
+
+    // Runs the tasks until all of them, including the ones they add, are completed
+    void run() {
+        std::vector<std::thread> threads;
+        for(size_t t = 0; t < queues.size(); t++) threads.emplace_back(&workPool::work, this, (int)t);
+        for(size_t t = 0; t < threads.size(); t++) threads[t].join();
+    }
+
+private:
+    struct taskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void(int)>> tasks;
+    };
+    std::vector<taskQueue> queues;
+    std::atomic<long> pending;
+
+    bool take(const int thread, std::function<void(int)> &task) {
+        for(size_t q = 0; q < queues.size(); q++) {
+            taskQueue &queue = queues[(thread + q) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+            if (q == 0) { // Own queue: newest task
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else { // Steal the oldest task, probably the biggest one
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void work(const int thread) {
+        std::function<void(int)> task;
+        while(pending > 0) {
+            if (!take(thread, task)) {
+                std::this_thread::yield();
+                continue;
+            }
+            task(thread);
+            pending--;
+        }
+    }
+};
+
+struct decodedMeasure {
+    uint64_t usec;   // Since the start of the capture
+    int capture;
+    measure m;
+};
+
+struct chunkJob {
+    std::shared_ptr<std::vector<uint32_t>> pulses;
+    size_t first, last;
+    uint64_t startUsec;
+    bool afterSync;  // Chunk starts right after a sync signal
+    int capture;
+};
+
+static timingProfile timing = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+static std::mutex resultsMutex;
+static std::vector<decodedMeasure> results;
+static std::atomic<long> totalPulses(0), totalPackets(0), queuedChunks(0);
+
+static void decodeChunk(const chunkJob &job) {
+    pulseFramer framer = {};
+    framer.lastSync = job.afterSync? 1 : 0;
+    uint32_t timings[TIMINGS_BUFFER_SIZE];
+    uint8_t bytes[6];
+    uint64_t usec = job.startUsec;
+    long packets = 0;
+    std::vector<decodedMeasure> decoded;
+    const std::vector<uint32_t> &pulses = *job.pulses;
+    for(size_t p = job.first; p < job.last; p++) {
+        usec += pulses[p];
+        if (!WS8610Receiver::addPulse(framer, pulses[p])) continue;
+        packets++;
+        WS8610Receiver::copyTimings(framer, timings);
+        if (WS8610Receiver::decodeFrame(timings, timing, bytes) != FRAME_OK) continue;
+        decoded.push_back({ usec, job.capture, WS8610Receiver::frameMeasure(bytes, usec / 1000) });
+    }
+    totalPackets += packets;
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    results.insert(results.end(), decoded.begin(), decoded.end());
+}
+
+static void decodeIndexed(const capture::binaryCapture &binary, const uint64_t first, const uint64_t last,
+                          const int capture) {
+    const size_t count = last - first;
+    std::vector<uint32_t> windows(count * TIMINGS_BUFFER_SIZE);
+    std::vector<uint8_t> bytes(count * 6);
+    std::vector<frameStatus> status(count);
+    for(size_t w = 0; w < count; w++) binary.packetTimings(first + w, &windows[w * TIMINGS_BUFFER_SIZE]);
+    batch::decodeFrames(windows.data(), count, timing, (uint8_t(*)[6])bytes.data(), status.data());
+
+    std::vector<decodedMeasure> decoded;
+    for(size_t w = 0; w < count; w++) {
+        if (status[w] != FRAME_OK) continue;
+        const uint64_t usec = binary.packet(first + w).usec;
+        decoded.push_back({ usec, capture, WS8610Receiver::frameMeasure(&bytes[w * 6], usec / 1000) });
+    }
+    totalPackets += last - first;
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    results.insert(results.end(), decoded.begin(), decoded.end());
+}
+
+static void splitCapture(workPool &pool, const int thread, const char *path, const int capture) {
+    std::shared_ptr<capture::binaryCapture> binary = std::make_shared<capture::binaryCapture>();
+    if (binary->open(path) && binary->hasIndex()) {
+        totalPulses += binary->header.pulseCount;
+        for(uint64_t first = 0; first < binary->packets(); first += CHUNK_PACKETS) {
+            const uint64_t last = std::min<uint64_t>(first + CHUNK_PACKETS, binary->packets());
+            pool.push(thread, [binary, first, last, capture](int) { decodeIndexed(*binary, first, last, capture); });
+        }
+        return;
+    }
+    // Other captures are streamed: chunks are queued as soon as they are read, and the reader helps
+    // decoding while too many of them are waiting, so huge captures are decoded in bounded memory
+    chunkJob job = { std::make_shared<std::vector<uint32_t>>(), 0, 0, 0, false, capture };
+    uint64_t usec = 0;
+    auto pushChunk = [&]() {
+        job.last = job.pulses->size();
+        queuedChunks++;
+        pool.push(thread, [job](int) { decodeChunk(job); queuedChunks--; });
+        job.startUsec = usec;
+        job.afterSync = true;
+        job.pulses = std::make_shared<std::vector<uint32_t>>();
+        job.pulses->reserve(CHUNK_PULSES);
+        while(queuedChunks > MAX_QUEUED_CHUNKS && pool.runOne(thread));
+    };
+    job.pulses->reserve(CHUNK_PULSES);
+    const long pulses = capture::read(path, [&](uint32_t d) {
+        usec += d;
+        job.pulses->push_back(d);
+        // Chunks are split only after a sync signal, so no packet spans two chunks
+        if (job.pulses->size() >= CHUNK_PULSES && d > 5000) pushChunk();
+    });
+    if (pulses < 0) {
+        fprintf(stderr, "Can't open %s\n", path);
+        return;
+    }
+    totalPulses += pulses;
+    if (!job.pulses->empty()) pushChunk();
+}
+
+int main(int argc, char *argv[]) {
+    int threads = std::thread::hardware_concurrency();
+    int a = 1;
+    for(; a < argc - 1 && argv[a][0] == '-'; a += 2) {
+        if (argv[a][1] == 'j') threads = atoi(argv[a + 1]);
+        else if (argv[a][1] == 't') timing.tolerance = atoi(argv[a + 1]);
+        else break;
+    }
+    if (a >= argc || threads < 1) {
+        fprintf(stderr, "Usage: %s [-j threads] [-t tolerance] capture.txt [more captures...]\n", argv[0]);
+        return 1;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    workPool pool(threads);
+    for(int c = 0; a + c < argc; c++) {
+        const char *path = argv[a + c];
+        pool.push(c % threads, [&pool, path, c](int thread) { splitCapture(pool, thread, path, c); });
+    }
+    pool.run();
+
+    std::sort(results.begin(), results.end(), [](const decodedMeasure &x, const decodedMeasure &y) {
+        if (x.m.sensorAddr != y.m.sensorAddr) return x.m.sensorAddr < y.m.sensorAddr;
+        if (x.capture != y.capture) return x.capture < y.capture;
+        return x.usec < y.usec;
+    });
+    printf("sensor,capture,msec,type,value\n");
+    for(size_t r = 0; r < results.size(); r++) {
+        const measure &m = results[r].m;
+        const int tenths = measureTenths(m);
+        printf("%u,%s,%llu,%s,%s%d.%d\n", m.sensorAddr, argv[a + results[r].capture],
+            (unsigned long long)(results[r].usec / 1000), (m.type == TEMPERATURE)? "T" : "H",
+            (tenths < 0)? "-" : "", abs(tenths) / 10, abs(tenths) % 10);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%ld pulses, %ld packets, %zu measures decoded by %d threads in %.2f s\n",
+        (long)totalPulses, (long)totalPackets, results.size(), threads, seconds);
+    return 0;
+}
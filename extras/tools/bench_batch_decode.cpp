@@ -0,0 +1,67 @@
+/*
+  Benchmarks the batch decoding kernels against the scalar decodeFrame(), after checking that
+  all of them give the same results, on synthetic windows: valid frames with jitter, frames
+  with a corrupted pulse, pulses at the edges of the tolerance windows and random timings.
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/bench_batch_decode.cpp -o bench_batch_decode
+  Usage: bench_batch_decode [windows]
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BatchDecode.h"
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+static void makeWindow(std::mt19937 &rng, uint32_t *timings) {
+    std::uniform_int_distribution<int> jitter(-150, 150), kind(0, 9);
+    const int k = kind(rng);
+    for(int t = 0; t < TIMINGS_BUFFER_SIZE; t++) {
+        if (k == 0) timings[t] = rng() % 3000; // Random timings
+        else if (k == 2) { // Edges of the tolerance windows
+            const int base = (t % 2)? PW_FIXED : ((rng() & 1)? PW_SHORT : PW_LONG);
+            timings[t] = base + ((rng() & 1)? 1 : -1) * (PW_TOLERANCE - 1 + (int)(rng() % 3));
+        }
+        else if (t % 2 == 0) timings[t] = ((rng() & 1)? PW_SHORT : PW_LONG) + jitter(rng);
+        else timings[t] = PW_FIXED + jitter(rng);
+    }
+    // A valid header, so that some frames get to the parity and checksum checks
+    for(int b = 0; b < 8 && k > 2; b++) timings[2*b] = ((0x0A >> (7 - b)) & 1)? PW_SHORT : PW_LONG;
+    if (k == 1) timings[rng() % TIMINGS_BUFFER_SIZE] = 1 + rng() % 5000; // Corrupted pulse
+    timings[TIMINGS_BUFFER_SIZE - 1] = 5000 + rng() % 20000;
+}
+
+int main(int argc, char *argv[]) {
+    const size_t count = (argc > 1)? strtoul(argv[1], nullptr, 10) : 1000000;
+    const timingProfile tp = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+    std::mt19937 rng(42);
+    std::vector<uint32_t> windows(count * TIMINGS_BUFFER_SIZE);
+    for(size_t w = 0; w < count; w++) makeWindow(rng, &windows[w * TIMINGS_BUFFER_SIZE]);
+
+    std::vector<uint8_t> expectedBytes(count * 6), bytes(count * 6);
+    std::vector<frameStatus> expectedStatus(count), status(count);
+    const batch::kernel best = batch::bestKernel();
+    printf("%zu windows, best kernel: %s\n", count, batch::kernelName(best));
+    for(int k = batch::SCALAR; k <= best; k++) {
+        std::vector<uint8_t> &b = (k == batch::SCALAR)? expectedBytes : bytes;
+        std::vector<frameStatus> &s = (k == batch::SCALAR)? expectedStatus : status;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        batch::decodeFrames(windows.data(), count, tp, (uint8_t(*)[6])b.data(), s.data(), (batch::kernel)k);
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        size_t mismatches = 0, valid = 0;
+        for(size_t w = 0; w < count; w++) {
+            if (s[w] == FRAME_OK) valid++;
+            if (k == batch::SCALAR) continue;
+            if (s[w] != expectedStatus[w] ||
+                (s[w] != TIMINGS_MISMATCH && memcmp(&b[w * 6], &expectedBytes[w * 6], 6) != 0)) mismatches++;
+        }
+        printf("%-7s %7.1f ns/window %8.2f M windows/s  %zu valid frames  %zu mismatches\n",
+            batch::kernelName((batch::kernel)k), ns / count, count * 1000.0 / ns, valid, mismatches);
+        if (mismatches > 0) return 1;
+    }
+    return 0;
+}
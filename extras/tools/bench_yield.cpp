@@ -0,0 +1,169 @@
+/*
+  Measures how the decode yield and the CPU cost change with the impairments of the signal: for
+  each combination of sensor count, pulse jitter and glitch rate, synthetic traffic (host/Synth.h)
+  is replayed through the interrupt handler and decodePacket(), and the decoded measures are
+  matched against the frames sent.
+
+  Columns:
+    sent       frames sent
+    recovered  sent frames decoded with the right sensor, type and value
+    clean      yield on the frames without collisions or dropouts
+    false+     decoded measures not matching any sent frame
+    ns/frame   CPU time of the receiver (interrupts and decoding) per recovered frame
+    overruns   packets lost because the packet buffer wrapped between two polls
+
+  The receiver is polled every -p ms of simulated time (default 1000), like a main loop would do.
+  Each combination simulates -d seconds of traffic (default 6 hours).
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/bench_yield.cpp -o bench_yield
+  Usage: bench_yield [-d seconds] [-p poll ms] [-t tolerance] [-l dropout rate] [-s seed]
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "Synth.h"
+#include "Replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+struct decodedAt {
+    uint64_t usec;  // Time of the poll that returned the measure
+    measure m;
+};
+
+struct result {
+    long sent, clean, recovered, recoveredClean, falsePositives, overruns;
+    double nsPerFrame;
+};
+
+// Matches every decoded measure with the oldest unmatched frame of the same sensor, type and value
+// sent at most windowUsec before it
+static void match(std::vector<sentFrame> &sent, std::vector<decodedAt> &decoded, const uint64_t windowUsec, result &r) {
+    auto key = [](const uint8_t addr, const measureType type) { return addr * 2 + type; };
+    std::stable_sort(sent.begin(), sent.end(), [&](const sentFrame &x, const sentFrame &y) {
+        return key(x.sensorAddr, x.type) < key(y.sensorAddr, y.type);
+    });
+    std::stable_sort(decoded.begin(), decoded.end(), [&](const decodedAt &x, const decodedAt &y) {
+        return key(x.m.sensorAddr, x.m.type) < key(y.m.sensorAddr, y.m.type);
+    });
+    std::vector<bool> matched(sent.size(), false);
+    size_t first = 0;
+    for(size_t d = 0; d < decoded.size(); d++) {
+        const measure &m = decoded[d].m;
+        const int k = key(m.sensorAddr, m.type);
+        while(first < sent.size() && key(sent[first].sensorAddr, sent[first].type) < k) first++;
+        bool found = false;
+        for(size_t s = first; s < sent.size() && key(sent[s].sensorAddr, sent[s].type) == k; s++) {
+            if (sent[s].usec > decoded[d].usec) break;
+            if (matched[s] || sent[s].tenths != measureTenths(m) ||
+                decoded[d].usec - sent[s].usec > windowUsec) continue;
+            matched[s] = found = true;
+            r.recovered++;
+            if (sent[s].flags == 0) r.recoveredClean++;
+            break;
+        }
+        if (!found) r.falsePositives++;
+    }
+}
+
+static result run(const int sensors, const synth::impairments &imp, const double seconds, const uint32_t pollMs,
+                  const timingProfile &tp, const uint64_t seed) {
+    result r = {};
+    std::vector<uint32_t> pulses;
+    std::vector<sentFrame> sent;
+    synth::generator generator(sensors, seed, imp, { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE });
+    generator.run((uint64_t)(seconds * 1000000), [&](uint32_t d) { pulses.push_back(d); },
+        [&](const sentFrame &f) {
+            sent.push_back(f);
+            if (f.flags == 0) r.clean++;
+        });
+    pulses.push_back(100000); // Ends the silence after the last frame
+    r.sent = sent.size();
+
+    // Poll times and packet counts are tracked outside the timed loop, with a framer of our own
+    std::vector<decodedAt> decoded;
+    pulseFramer framer = {};
+    framer.lastSync = 1;
+    long packetsSincePoll = 0;
+    uint64_t usec = 0, nextPoll = pollMs * 1000ULL;
+    std::vector<size_t> polls;
+    std::vector<uint64_t> pollUsec;
+    for(size_t p = 0; p < pulses.size(); p++) {
+        usec += pulses[p];
+        if (WS8610Receiver::addPulse(framer, pulses[p])) packetsSincePoll++;
+        if (usec >= nextPoll || p + 1 == pulses.size()) {
+            polls.push_back(p + 1);
+            pollUsec.push_back(usec);
+            // A buffer wrap between two polls loses all the packets it contained
+            if (packetsSincePoll >= PACKET_BUFFER_SIZE) r.overruns += packetsSincePoll - packetsSincePoll % PACKET_BUFFER_SIZE;
+            packetsSincePoll = 0;
+            while(nextPoll <= usec) nextPoll += pollMs * 1000ULL;
+        }
+    }
+
+    WS8610Receiver receiver(2);
+    receiver.setNominalTiming(tp);
+    receiver.enableReceive();
+    host::pulse(100000); // Syncs the static framer of the receiver
+    std::vector<measure> measures;
+    measures.reserve(sent.size() + 1024);
+    std::vector<size_t> pollMeasures(polls.size());
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t p = 0;
+    for(size_t poll = 0; poll < polls.size(); poll++) {
+        for(; p < polls[poll]; p++) host::pulse(pulses[p]);
+        host::drain(receiver, [&](const measure &m) { measures.push_back(m); });
+        pollMeasures[poll] = measures.size();
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    receiver.disableReceive();
+
+    size_t m = 0;
+    for(size_t poll = 0; poll < polls.size(); poll++) {
+        for(; m < pollMeasures[poll]; m++) decoded.push_back({ pollUsec[poll], measures[m] });
+    }
+    // The last frame of a transmission is completed only by the next one, then waits for a poll
+    match(sent, decoded, 2ULL * (SYNTH_PERIOD + SYNTH_PERIOD_SPREAD) + pollMs * 1000ULL, r);
+    r.nsPerFrame = (r.recovered > 0)? ns / r.recovered : 0;
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    double seconds = 6 * 3600;
+    uint32_t pollMs = 1000;
+    double dropoutRate = 0;
+    uint64_t seed = 1;
+    timingProfile tp = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+    for(int a = 1; a < argc; a += 2) {
+        if (a + 1 >= argc || argv[a][0] != '-') {
+            fprintf(stderr, "Usage: %s [-d seconds] [-p poll ms] [-t tolerance] [-l dropout rate] [-s seed]\n", argv[0]);
+            return 1;
+        }
+        if (argv[a][1] == 'd') seconds = atof(argv[a + 1]);
+        else if (argv[a][1] == 'p') pollMs = atoi(argv[a + 1]);
+        else if (argv[a][1] == 't') tp.tolerance = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'l') dropoutRate = atof(argv[a + 1]);
+        else if (argv[a][1] == 's') seed = strtoull(argv[a + 1], nullptr, 10);
+    }
+
+    const int sensorCounts[] = { 1, 8, 32 };
+    const uint32_t jitters[] = { 0, 100, 150, 200, 250 };
+    const double glitchRates[] = { 0, 0.001, 0.01, 0.05 };
+    printf("sensors jitter glitches     sent recovered  yield%%  clean%%  false+  ns/frame  overruns\n");
+    for(const int sensors : sensorCounts) {
+        for(const uint32_t jitter : jitters) {
+            for(const double glitches : glitchRates) {
+                const synth::impairments imp = { jitter, glitches, dropoutRate, 5000 };
+                const result r = run(sensors, imp, seconds, pollMs, tp, seed);
+                printf("%7d %6u %8.3f %8ld %9ld %7.1f %7.1f %7ld %9.0f %9ld\n", sensors, jitter, glitches,
+                    r.sent, r.recovered, (r.sent > 0)? 100.0 * r.recovered / r.sent : 0,
+                    (r.clean > 0)? 100.0 * r.recoveredClean / r.clean : 0, r.falsePositives, r.nsPerFrame, r.overruns);
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+/*
+  Converts a capture (text or binary) to the binary format, writing also its packet index.
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/capture_convert.cpp -o capture_convert
+  Usage: capture_convert input output.wsc [start time, Unix ms]
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BinaryCapture.h"
+#include <stdlib.h>
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s input output.wsc [start time, Unix ms]\n", argv[0]);
+        return 1;
+    }
+    capture::writer writer;
+    if (!writer.open(argv[2], (argc > 3)? strtoull(argv[3], nullptr, 10) : 0)) {
+        fprintf(stderr, "Can't write %s\n", argv[2]);
+        return 1;
+    }
+    const long pulses = capture::read(argv[1], [&](uint32_t d) { writer.addPulse(d); });
+    writer.close();
+    if (pulses < 0) {
+        fprintf(stderr, "Can't open %s\n", argv[1]);
+        return 1;
+    }
+    capture::binaryCapture binary;
+    binary.open(argv[2]);
+    printf("%ld pulses, %llu packets indexed in %s\n", pulses, (unsigned long long)binary.packets(),
+        capture::indexPath(argv[2]).c_str());
+    return 0;
+}
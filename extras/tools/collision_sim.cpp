@@ -0,0 +1,97 @@
+/*
+  Replays synthetic traffic (host/Synth.h) of many sensors through a receiver with
+  WS8610_COLLISION_DETECTION and compares the collisions it counts with the overlapping transmissions
+  actually sent, to check the detection and to plan how many sensors a channel can take.
+
+  Printed:
+    overlaps    groups of overlapping (or back to back) transmissions sent, from the ground truth
+    collided    frames sent that overlapped another transmission
+    counted     collisions counted by the receiver, and per hour by getCollisionsLastHour()
+    recovered   frames found before a packet window (ended without their sync signal)
+    yield       frames sent decoded with the right sensor, type and value, and false positives
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/collision_sim.cpp -o collision_sim
+  Usage: collision_sim [-n sensors] [-m minutes] [-j jitter] [-g glitch rate] [-s seed]
+    defaults: 32 sensors, 60 minutes, no jitter nor glitches
+*/
+
+#include "Arduino.h"
+#define WS8610_COLLISION_DETECTION
+#include "WS8610Receiver.h"
+#include "Synth.h"
+#include "Replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct sent {
+    sentFrame frame;
+    bool decoded;
+};
+
+int main(int argc, char *argv[]) {
+    int sensors = 32, minutes = 60;
+    uint32_t jitter = 0;
+    double glitchRate = 0;
+    uint64_t seed = 1;
+    for(int a = 1; a < argc; a += 2) {
+        if (a + 1 >= argc || argv[a][0] != '-') {
+            fprintf(stderr, "Usage: %s [-n sensors] [-m minutes] [-j jitter] [-g glitch rate] [-s seed]\n", argv[0]);
+            return 1;
+        }
+        if (argv[a][1] == 'n') sensors = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'm') minutes = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'j') jitter = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'g') glitchRate = atof(argv[a + 1]);
+        else if (argv[a][1] == 's') seed = strtoull(argv[a + 1], nullptr, 10);
+    }
+
+    std::vector<uint32_t> pulses;
+    std::vector<sent> frames;
+    synth::generator generator(sensors, seed, { jitter, glitchRate, 0, 0 });
+    generator.run(minutes * 60000000ULL, [&](uint32_t d) { pulses.push_back(d); },
+        [&](const sentFrame &f) { frames.push_back({ f, false }); });
+    pulses.push_back(100000); // Ends the silence after the last frame
+
+    // Overlaps of the ground truth: collided frames closer than a transmission belong to the same one
+    long collided = 0, overlaps = 0;
+    uint64_t lastCollided = 0;
+    for(size_t f = 0; f < frames.size(); f++) {
+        if (!(frames[f].frame.flags & SENT_COLLIDED)) continue;
+        if (collided == 0 || frames[f].frame.usec - lastCollided > 500000) overlaps++;
+        lastCollided = frames[f].frame.usec;
+        collided++;
+    }
+
+    WS8610Receiver receiver(2);
+    receiver.enableReceive();
+    host::pulse(100000); // Syncs the static framer of the receiver
+    long delivered = 0, falsePositives = 0;
+    size_t first = 0;
+    host::replay(receiver, pulses.data(), pulses.size(), [&](const measure &m) {
+        delivered++;
+        // The first frame sent with the same content not matched yet
+        bool found = false;
+        for(size_t f = first; f < frames.size() && !found; f++) {
+            const sentFrame &s = frames[f].frame;
+            if (s.usec / 1000 > m.msec) break;
+            if (frames[f].decoded || s.sensorAddr != m.sensorAddr || s.type != m.type || s.tenths != measureTenths(m)) {
+                continue;
+            }
+            frames[f].decoded = found = true;
+        }
+        if (!found) falsePositives++;
+        while(first < frames.size() && frames[first].frame.usec / 1000 + SYNTH_PERIOD / 1000 < m.msec) first++;
+    });
+
+    long decoded = 0;
+    for(size_t f = 0; f < frames.size(); f++) decoded += frames[f].decoded;
+    const collisionStats stats = receiver.getCollisionStats();
+    printf("%zu frames sent by %d sensors in %d minutes\n", frames.size(), sensors, minutes);
+    printf("overlaps  %ld (%ld frames collided)\n", overlaps, collided);
+    printf("counted   %u, %u in the last hour\n", stats.collisions, receiver.getCollisionsLastHour());
+    printf("recovered %u frames\n", stats.recovered);
+    printf("yield     %.2f%% (%ld decoded), %ld false positives\n", 100.0 * decoded / (frames.size() > 0? frames.size() : 1),
+        decoded, falsePositives);
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+  Feeds the same synthetic traffic (host/Synth.h) to the two radios of a WS8610Diversity, each one with
+  its own independent pulse jitter, noise glitches and signal dropouts, as two receivers on antennas in
+  different places, and counts the frames sent that each radio decodes alone, that at least one of them
+  decodes and that the combiner delivers (merged copies included).
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/diversity_sim.cpp -o diversity_sim
+  Usage: diversity_sim [-n sensors] [-m minutes] [-j jitter] [-g glitch rate] [-d dropout rate] [-l dropout µs] [-s seed]
+    defaults: 4 sensors, 60 minutes, 60 µs jitter, 0.002 glitches per pulse, 0.3 dropouts per frame of 2000 µs
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "WS8610Diversity.h"
+#include "Synth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+struct edge {
+    uint64_t usec;
+    int radio;
+    bool operator<(const edge &e) const { return usec < e.usec; }
+};
+
+struct sent {
+    sentFrame frame;
+    uint8_t radios; // Radios that decoded it alone
+    bool delivered, merged;
+};
+
+// Edges of a radio: each one moved by up to +/- jitter µs, a glitch (two close edges) now and then, and
+// the edges inside a dropout removed in pairs, so the level after it is right
+static void impair(const std::vector<uint64_t> &edges, const std::vector<sent> &frames, const int radio,
+                   const uint32_t jitter, const double glitchRate, const double dropoutRate,
+                   const uint32_t dropoutUsec, synth::rng &random, std::vector<edge> &out) {
+    std::vector<std::pair<uint64_t, uint64_t>> dropouts;
+    const uint32_t dropoutThreshold = synth::rng::chance(dropoutRate);
+    for(size_t f = 0; f < frames.size(); f++) {
+        if (!random.hit(dropoutThreshold)) continue;
+        const uint64_t from = frames[f].frame.usec + random.below(100000);
+        dropouts.push_back(std::make_pair(from, from + dropoutUsec));
+    }
+    const uint32_t glitchThreshold = synth::rng::chance(glitchRate);
+    size_t d = 0;
+    uint64_t last = 0;
+    bool skip = false;
+    for(size_t e = 0; e < edges.size(); e++) {
+        while(d < dropouts.size() && dropouts[d].second < edges[e]) d++;
+        if (skip || (d < dropouts.size() && edges[e] >= dropouts[d].first)) {
+            skip = !skip;
+            continue;
+        }
+        uint64_t t = edges[e] + random.around(jitter);
+        if (t <= last) t = last + 1;
+        out.push_back({ t, radio });
+        if (random.hit(glitchThreshold)) {
+            const uint64_t g = t + 200 + random.below(300);
+            out.push_back({ g, radio });
+            out.push_back({ g + 10 + random.below(NOISE_THRESHOLD - 10), radio });
+            t = out.back().usec;
+        }
+        last = t;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int sensors = 4, minutes = 60;
+    uint32_t jitter = 60, dropoutUsec = 2000;
+    double glitchRate = 0.002, dropoutRate = 0.3;
+    uint64_t seed = 1;
+    for(int a = 1; a < argc; a += 2) {
+        if (a + 1 >= argc || argv[a][0] != '-') {
+            fprintf(stderr, "Usage: %s [-n sensors] [-m minutes] [-j jitter] [-g glitch rate] [-d dropout rate] "
+                "[-l dropout µs] [-s seed]\n", argv[0]);
+            return 1;
+        }
+        if (argv[a][1] == 'n') sensors = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'm') minutes = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'j') jitter = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'g') glitchRate = atof(argv[a + 1]);
+        else if (argv[a][1] == 'd') dropoutRate = atof(argv[a + 1]);
+        else if (argv[a][1] == 'l') dropoutUsec = atoi(argv[a + 1]);
+        else if (argv[a][1] == 's') seed = strtoull(argv[a + 1], nullptr, 10);
+    }
+
+    // Clean traffic: edges and frames sent
+    std::vector<uint64_t> clean;
+    std::vector<sent> frames;
+    uint64_t t = 0;
+    synth::generator generator(sensors, seed, { 0, 0, 0, 0 });
+    generator.run(minutes * 60000000ULL, [&](uint32_t d) {
+        t += d;
+        clean.push_back(t);
+    }, [&](const sentFrame &f) {
+        frames.push_back({ f, 0, false, false });
+    });
+
+    synth::rng random(seed * 31 + 7);
+    std::vector<edge> edges;
+    for(int r = 0; r < DIVERSITY_RADIOS; r++) {
+        impair(clean, frames, r, jitter, glitchRate, dropoutRate, dropoutUsec, random, edges);
+    }
+    std::sort(edges.begin(), edges.end());
+
+    WS8610Diversity diversity(0, 1);
+    diversity.enableReceive();
+    host::pinChange(0, 100000); // Syncs the framers
+    host::pinChange(1, 0);
+    uint64_t now = 0;
+    long delivered = 0, falsePositives = 0;
+    size_t first = 0;
+    auto drain = [&]() {
+        int n = diversity.receivedMeasures();
+        while(n-- > 0) {
+            const diversityMeasure d = diversity.getNextMeasure();
+            delivered++;
+            // The first frame sent with the same content not matched yet. A packet is stamped at the end of
+            // the sync signal, which for the last frame of a transmission is the start of the next one
+            bool found = false;
+            for(size_t f = first; f < frames.size() && !found; f++) {
+                const sentFrame &s = frames[f].frame;
+                if (s.usec / 1000 > d.m.msec) break;
+                if (s.sensorAddr != d.m.sensorAddr || s.type != d.m.type || s.tenths != measureTenths(d.m) ||
+                    frames[f].delivered) continue;
+                frames[f].delivered = found = true;
+                frames[f].merged = d.merged;
+                if (!d.merged) frames[f].radios = d.radios;
+            }
+            if (!found) falsePositives++;
+            while(first < frames.size() && frames[first].frame.usec / 1000 + SYNTH_PERIOD / 1000 < d.m.msec) first++;
+        }
+    };
+    for(size_t e = 0; e < edges.size(); e++) {
+        host::pinChange(edges[e].radio, (uint32_t)(edges[e].usec - now));
+        now = edges[e].usec;
+        if (e % 64 == 0) drain();
+    }
+    host::pinChange(0, 100000);
+    host::pinChange(1, 0);
+    drain();
+
+    long single[DIVERSITY_RADIOS] = { 0 }, either = 0, combined = 0, merged = 0;
+    for(size_t f = 0; f < frames.size(); f++) {
+        for(int r = 0; r < DIVERSITY_RADIOS; r++) single[r] += (frames[f].radios >> r) & 1;
+        either += frames[f].radios != 0;
+        combined += frames[f].delivered;
+        merged += frames[f].merged;
+    }
+    const double sentFrames = frames.size() > 0? frames.size() : 1;
+    const diversityStats stats = diversity.getStats();
+    printf("%zu frames sent by %d sensors in %d minutes\n", frames.size(), sensors, minutes);
+    for(int r = 0; r < DIVERSITY_RADIOS; r++) {
+        printf("radio %d alone  %6.2f%% (%u decoded, %u by it only)\n", r, 100 * single[r] / sentFrames,
+            stats.decoded[r], stats.exclusive[r]);
+    }
+    printf("either radio   %6.2f%%\n", 100 * either / sentFrames);
+    printf("combined       %6.2f%% (%ld merged from failed copies)\n", 100 * combined / sentFrames, merged);
+    printf("%ld measures delivered, %ld false positives, %u packets unrecovered\n", delivered, falsePositives,
+        stats.unrecovered);
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+  Stores days of synthetic measures (host/Synth.h) in a WS8610History ring over a flash-like page
+  store (host/PageStore.h) and checks them back:
+    - every -u minutes the uplink comes back and the measures not replayed yet are replayed and
+      compared with the ones added, which must come back in order (repeated measures excluded). If the
+      uplink stayed down longer than the ring holds, the oldest ones are overwritten: a replay may then
+      start later than the first measure not replayed, and the ones skipped are counted as overwritten;
+    - halfway the history is reopened on the same pages, as after a restart of the board;
+    - at the end the whole ring is replayed, to see how long a history it holds.
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/history_store.cpp -o history_store
+  Usage: history_store [-n sensors] [-d days] [-u minutes] [-p page size] [-c pages] [-f file] [-s seed]
+    defaults: 2 sensors, 3 days, uplink every 60 minutes, 16 pages of 256 bytes (the 4 KB of EEPROM
+    of an Arduino Mega), in memory
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "WS8610History.h"
+#include "Synth.h"
+#include "PageStore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <memory>
+
+struct checker {
+    std::deque<measure> added;
+    measure last[256];  // Last measure replayed per sensor address and type
+    bool hasLast[256];
+    long replayed, mismatches, overwritten;
+    bool first;         // First measure of a replay
+
+    checker() : replayed(0), mismatches(0), overwritten(0), first(false) {
+        for(int k = 0; k < 256; k++) hasLast[k] = false;
+    }
+
+    static int key(const measure &m) { return m.sensorAddr * 2 + m.type; }
+
+    static bool same(const measure &a, const measure &b) {
+        return a.msec / HISTORY_TIME_UNIT == b.msec / HISTORY_TIME_UNIT && key(a) == key(b) &&
+               measureTenths(a) == measureTenths(b);
+    }
+
+    // Same value of the previous measure, at most a time unit later
+    static bool repeated(const measure &m, const measure &previous) {
+        const uint32_t units = m.msec / HISTORY_TIME_UNIT - previous.msec / HISTORY_TIME_UNIT;
+        return units <= 1 && key(m) == key(previous) && measureTenths(m) == measureTenths(previous);
+    }
+
+    template<typename H>
+    void replay(H &history) {
+        first = true;
+        history.replay([&](const measure &m) { check(m); });
+    }
+
+    void check(const measure &m) {
+        replayed++;
+        // The history stores a repeated measure only once
+        while(!added.empty() && !same(added.front(), m) && hasLast[key(added.front())] &&
+              repeated(added.front(), last[key(added.front())])) added.pop_front();
+        if (first && !added.empty() && !same(added.front(), m) && added.front().msec <= m.msec) {
+            // Pages erased before being replayed: the replay starts from the oldest page left
+            size_t skip = 0;
+            while(skip < added.size() && !same(added[skip], m)) skip++;
+            if (skip < added.size()) {
+                overwritten += skip;
+                added.erase(added.begin(), added.begin() + skip);
+            }
+        }
+        first = false;
+        if (added.empty() || !same(added.front(), m)) mismatches++;
+        else added.pop_front();
+        last[key(m)] = m;
+        hasLast[key(m)] = true;
+    }
+};
+
+int main(int argc, char *argv[]) {
+    int sensors = 2;
+    double days = 3;
+    uint32_t uplinkMinutes = 60;
+    uint16_t pageSize = 256, pages = 16;
+    const char *path = nullptr;
+    uint64_t seed = 1;
+    for(int a = 1; a < argc; a += 2) {
+        if (a + 1 >= argc || argv[a][0] != '-') {
+            fprintf(stderr, "Usage: %s [-n sensors] [-d days] [-u minutes] [-p page size] [-c pages] [-f file] [-s seed]\n",
+                argv[0]);
+            return 1;
+        }
+        if (argv[a][1] == 'n') sensors = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'd') days = atof(argv[a + 1]);
+        else if (argv[a][1] == 'u') uplinkMinutes = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'p') pageSize = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'c') pages = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'f') path = argv[a + 1];
+        else if (argv[a][1] == 's') seed = strtoull(argv[a + 1], nullptr, 10);
+    }
+    if (path != nullptr) remove(path);
+
+    host::pageStore store(pageSize, pages, path);
+    std::unique_ptr<WS8610History<host::pageStore>> history(new WS8610History<host::pageStore>(store));
+    if (!history->begin()) {
+        fprintf(stderr, "The history needs at least 2 pages\n");
+        return 1;
+    }
+    checker chk;
+    long measures = 0, restarts = 0;
+    const uint64_t duration = (uint64_t)(days * 86400e6);
+    uint64_t nextUplink = uplinkMinutes * 60000000ULL;
+    bool restarted = false;
+
+    const synth::impairments imp = { 0, 0, 0, 5000 };
+    synth::generator generator(sensors, seed, imp);
+    generator.run(duration, [](uint32_t) {}, [&](const sentFrame &f) {
+        if (uplinkMinutes > 0 && f.usec >= nextUplink) {
+            chk.replay(*history);
+            while(nextUplink <= f.usec) nextUplink += uplinkMinutes * 60000000ULL;
+        }
+        if (!restarted && f.usec >= duration / 2) {
+            // Restart right after an uplink: the replay position is lost, so the measures already
+            // replayed are skipped
+            restarted = true;
+            if (uplinkMinutes > 0) chk.replay(*history);
+            store.save();
+            history.reset(new WS8610History<host::pageStore>(store));
+            history->begin();
+            history->replay([](const measure&) {});
+            restarts++;
+        }
+        measure m = { (uint32_t)(f.usec / 1000), f.sensorAddr, f.type, 0, 0 };
+        m.units = (f.tenths >= 0)? f.tenths / 10 : -((-f.tenths + 9) / 10);
+        m.decimals = f.tenths - m.units * 10;
+        history->addMeasure(m);
+        chk.added.push_back(m);
+        measures++;
+    });
+    if (uplinkMinutes > 0) chk.replay(*history);
+
+    // Whole ring
+    history->rewind();
+    uint32_t first = 0, lastMsec = 0;
+    const uint32_t held = history->replay([&](const measure &m) {
+        if (first == 0) first = m.msec;
+        lastMsec = m.msec;
+    });
+    uint32_t minErases = 0xFFFFFFFF, maxErases = 0;
+    for(uint16_t p = 0; p < pages; p++) {
+        if (store.pageErases(p) < minErases) minErases = store.pageErases(p);
+        if (store.pageErases(p) > maxErases) maxErases = store.pageErases(p);
+    }
+    const double bytes = (double)pageSize * pages;
+    printf("%ld measures of %d sensors in %.1f days, %ld restart(s)\n", measures, sensors, days, restarts);
+    printf("replayed %ld, mismatches %ld, overwritten before the replay %ld, stored %u (repeated ones excluded)\n",
+        chk.replayed, chk.mismatches, chk.overwritten, history->getStoredMeasures());
+    printf("ring of %u x %u bytes holds %u measures, %.1f hours (%.2f bits per measure)\n", pages, pageSize, held,
+        (lastMsec - first) / 3600000.0, (held > 0)? bytes * 8 / held : 0);
+    printf("page erases %u-%u, writes setting bits %u\n", minErases, maxErases, store.badWrites);
+    return (chk.mismatches > 0 || store.badWrites > 0)? 1 : 0;
+}
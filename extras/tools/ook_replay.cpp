@@ -0,0 +1,94 @@
+/*
+  Replays a capture (usually rtl_433 pulse data) through the interrupt handler of a receiver and
+  prints the decoded measures. The pulses are streamed, so captures of any size can be replayed.
+
+  To compare the yield with rtl_433 on the same capture, save its decoded messages with
+      rtl_433 -r file.ook -F json > file.json
+  and pass the file as second argument: the LaCrosse-TX messages are counted by sensor and type
+  next to the measures decoded here.
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/ook_replay.cpp -o ook_replay
+  Usage: ook_replay capture.ook [rtl_433.json]
+  Output (CSV): msec,sensor,type,value
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BinaryCapture.h"
+#include "Replay.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct sensorCounts {
+    long measures[2];   // By measureType
+    long rtl433[2];
+};
+
+// Counts the LaCrosse-TX messages of an rtl_433 JSON output, one message per line
+static long readRtl433(const char *path, sensorCounts counts[128]) {
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) return -1;
+    long messages = 0;
+    char line[1024];
+    while(fgets(line, sizeof(line), f) != nullptr) {
+        const char *model = strstr(line, "\"model\"");
+        const char *id = strstr(line, "\"id\"");
+        if (model == nullptr || id == nullptr || strstr(model, "LaCrosse-TX") == nullptr) continue;
+        id = strchr(id + 4, ':');
+        if (id == nullptr) continue;
+        const long addr = strtol(id + 1, nullptr, 10);
+        if (addr < 0 || addr > 127) continue;
+        if (strstr(line, "\"temperature_C\"") != nullptr) counts[addr].rtl433[TEMPERATURE]++;
+        else if (strstr(line, "\"humidity\"") != nullptr) counts[addr].rtl433[HUMIDITY]++;
+        else continue;
+        messages++;
+    }
+    fclose(f);
+    return messages;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s capture.ook [rtl_433.json]\n", argv[0]);
+        return 1;
+    }
+    sensorCounts counts[128] = {};
+    long measures = 0;
+    WS8610Receiver receiver(2);
+    receiver.enableReceive();
+    auto onMeasure = [&](const measure &m) {
+        const int tenths = measureTenths(m);
+        printf("%lu,%u,%s,%s%d.%d\n", (unsigned long)m.msec, m.sensorAddr, (m.type == TEMPERATURE)? "T" : "H",
+            (tenths < 0)? "-" : "", abs(tenths) / 10, abs(tenths) % 10);
+        counts[m.sensorAddr & 0x7F].measures[m.type]++;
+        measures++;
+    };
+    printf("msec,sensor,type,value\n");
+    const long pulses = capture::read(argv[1], [&](uint32_t d) {
+        host::pulse(d);
+        host::drain(receiver, onMeasure);
+    });
+    if (pulses < 0) {
+        fprintf(stderr, "Can't open %s\n", argv[1]);
+        return 1;
+    }
+    host::pulse(100000); // Flushes the last packet
+    host::drain(receiver, onMeasure);
+    fprintf(stderr, "%ld pulses, %ld measures\n", pulses, measures);
+
+    if (argc < 3) return 0;
+    const long messages = readRtl433(argv[2], counts);
+    if (messages < 0) {
+        fprintf(stderr, "Can't open %s\n", argv[2]);
+        return 1;
+    }
+    fprintf(stderr, "sensor  temperature (here/rtl_433)  humidity (here/rtl_433)\n");
+    for(int s = 0; s < 128; s++) {
+        const sensorCounts &c = counts[s];
+        if (c.measures[0] + c.measures[1] + c.rtl433[0] + c.rtl433[1] == 0) continue;
+        fprintf(stderr, "%6d  %13ld / %-11ld  %10ld / %ld\n", s, c.measures[TEMPERATURE], c.rtl433[TEMPERATURE],
+            c.measures[HUMIDITY], c.rtl433[HUMIDITY]);
+    }
+    fprintf(stderr, "total   %ld measures here, %ld messages from rtl_433\n", measures, messages);
+    return 0;
+}
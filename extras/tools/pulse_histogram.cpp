@@ -0,0 +1,57 @@
+/*
+  Prints the histogram of the pulse durations in a capture, as counted by the receiver
+  interrupt handler, together with the decoding windows currently configured.
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/pulse_histogram.cpp -o pulse_histogram
+  Usage: pulse_histogram capture.txt [more captures...]
+*/
+
+#define WS8610_PULSE_HISTOGRAM
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BinaryCapture.h"
+
+static const char* pulseClass(const uint32_t from, const uint32_t to) {
+    if (to <= NOISE_THRESHOLD) return "noise";
+    if (from > 5000) return "sync";
+    if (from < PW_SHORT + PW_TOLERANCE && to > PW_SHORT - PW_TOLERANCE) return "SHORT";
+    if (from <= PW_FIXED + PW_TOLERANCE && to >= PW_FIXED - PW_TOLERANCE) return "FIXED";
+    if (from < PW_LONG + PW_TOLERANCE && to > PW_LONG - PW_TOLERANCE) return "LONG";
+    return "";
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s capture.txt [more captures...]\n", argv[0]);
+        return 1;
+    }
+    WS8610Receiver receiver(2);
+    receiver.enableReceive();
+    long pulses = 0;
+    for(int a = 1; a < argc; a++) {
+        long read = capture::read(argv[a], host::pulse);
+        if (read < 0) {
+            fprintf(stderr, "Can't open %s\n", argv[a]);
+            return 1;
+        }
+        pulses += read;
+    }
+
+    uint16_t counts[HISTOGRAM_BUCKETS + 1];
+    WS8610Receiver::getPulseHistogram(counts);
+    uint16_t maxCount = 1;
+    for(int b = 0; b <= HISTOGRAM_BUCKETS; b++) if (counts[b] > maxCount) maxCount = counts[b];
+
+    printf("%ld pulses, %d µs buckets\n", pulses, HISTOGRAM_BUCKET_WIDTH);
+    for(int b = 0; b <= HISTOGRAM_BUCKETS; b++) {
+        if (counts[b] == 0) continue;
+        const uint32_t from = b * HISTOGRAM_BUCKET_WIDTH;
+        const uint32_t to = from + HISTOGRAM_BUCKET_WIDTH - 1;
+        if (b < HISTOGRAM_BUCKETS) printf("%5u-%5u", from, to);
+        else printf("%5u+     ", from);
+        printf(" %6u %-5s ", counts[b], pulseClass(from, to));
+        for(int c = counts[b] * 50 / maxCount; c > 0; c--) putchar('#');
+        putchar('\n');
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+/*
+  Prints the measures of a binary stream sent by WS8610Output, e.g. saved from the serial port
+  (stty -F /dev/ttyUSB0 115200 raw; cat /dev/ttyUSB0 | read_measures -).
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/read_measures.cpp -o read_measures
+  Usage: read_measures stream.bin|-
+  Output (CSV): msec,sensor,type,value (type S is a stale sensor, with the time it was last seen)
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "WS8610Output.h"
+#include "MeasureStream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s stream.bin|-\n", argv[0]);
+        return 1;
+    }
+    FILE *in = (strcmp(argv[1], "-") == 0)? stdin : fopen(argv[1], "rb");
+    if (in == nullptr) {
+        fprintf(stderr, "Can't open %s\n", argv[1]);
+        return 1;
+    }
+    output::measureDecoder decoder;
+    printf("msec,sensor,type,value\n");
+    uint8_t buffer[4096];
+    size_t read;
+    while((read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        decoder.addBytes(buffer, read, [](const measure &m) {
+            if (m.type == SENSOR_STALE) {
+                printf("%lu,%u,S,\n", (unsigned long)m.msec, m.sensorAddr);
+                return;
+            }
+            const int tenths = measureTenths(m);
+            printf("%lu,%u,%s,%s%d.%d\n", (unsigned long)m.msec, m.sensorAddr, (m.type == TEMPERATURE)? "T" : "H",
+                (tenths < 0)? "-" : "", abs(tenths) / 10, abs(tenths) % 10);
+        });
+        fflush(stdout);
+    }
+    if (in != stdin) fclose(in);
+    fprintf(stderr, "%ld measures, %ld bad frames\n", decoder.frames, decoder.bad);
+    return 0;
+}
@@ -0,0 +1,391 @@
+/*
+  Replays the golden corpus and checks every case twice: the status of the offline decoding
+  (addPulse() and decodeFrame()) and the measure given by the receiver, with the pulses going
+  through the interrupt handler and decodePacket(). Then reports the yield on a fixed synthetic
+  traffic (host/Synth.h), to be compared between commits.
+
+  Corpus format (extras/corpus/golden.txt):
+    case <name> <expected status> [<sensor> <T|H> <value>]
+    <pulse durations of the packet, ending with its sync signal>
+  Expected status is OK (with the measure), TIMINGS_MISMATCH, WRONG_START, PARITY_ERROR,
+  CHECKSUM_ERROR or NO_PACKET. Lines starting with '#' are comments.
+
+  Built with -DWS8610_PLAUSIBILITY, every golden case starts from a receiver without the last values of
+  the sensors and with the range of the frames as plausible one, so the same cases still pass, and then
+  extras/corpus/plausibility.txt is replayed in order with the default settings: bad digits, values out
+  of range and a jump held until the next frame confirms it.
+
+  Built with -DWS8610_STALE_SENSORS, a few timed cases check the stale sensors: no event before the
+  deadline tick, a new measure moving the deadline, a single SENSOR_STALE event delivered through
+  getNextMeasure() after it, and the sensor no longer stale once it's seen again.
+
+  Built with -DWS8610_ADAPTIVE_TIMING, every golden case starts from the nominal timing, and a case
+  replays an hour of a sensor with 150 µs of jitter, which must keep being decoded once its profile
+  has settled.
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/regression.cpp -o regression
+         (add -DWS8610_PLAUSIBILITY for the plausibility cases, -DWS8610_STALE_SENSORS for the stale ones,
+         -DWS8610_ADAPTIVE_TIMING for the adaptive timing ones)
+  Usage: regression [corpus] [report]       (default extras/corpus/golden.txt and test_output.txt)
+         regression -a capture              prints the packets of a capture as corpus cases, with
+                                            their current result as expected one
+  Returns 1 if any case fails.
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BinaryCapture.h"
+#include "Synth.h"
+#include "Replay.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define CASE_SEPARATOR 20000 // Silence before each case (µs)
+
+static const char *statusNames[] = { "OK", "TIMINGS_MISMATCH", "WRONG_START", "PARITY_ERROR", "CHECKSUM_ERROR", "NO_PACKET" };
+#define NO_PACKET 5
+
+struct corpusCase {
+    std::string name;
+    int status;
+    bool hasMeasure;
+    uint8_t sensorAddr;
+    measureType type;
+    int tenths;
+    std::vector<uint32_t> pulses;
+};
+
+static std::string formatMeasure(const uint8_t sensorAddr, const measureType type, const int tenths) {
+    char text[32];
+    snprintf(text, sizeof(text), "%u %s %s%d.%d", sensorAddr, (type == TEMPERATURE)? "T" : "H",
+        (tenths < 0)? "-" : "", abs(tenths) / 10, abs(tenths) % 10);
+    return text;
+}
+
+static bool readCorpus(const char *path, std::vector<corpusCase> &cases) {
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) return false;
+    char line[1024];
+    while(fgets(line, sizeof(line), f) != nullptr) {
+        if (line[0] == '#') continue;
+        if (strncmp(line, "case ", 5) == 0) {
+            char name[128], status[32], type[4];
+            int sensor;
+            double value;
+            const int fields = sscanf(line + 5, "%127s %31s %d %3s %lf", name, status, &sensor, type, &value);
+            corpusCase c = { name, -1, fields == 5, (uint8_t)sensor, (type[0] == 'H')? HUMIDITY : TEMPERATURE,
+                             (int)lround(value * 10), {} };
+            for(int s = 0; s <= NO_PACKET; s++) {
+                if (strcmp(status, statusNames[s]) == 0) c.status = s;
+            }
+            if (fields < 2 || c.status < 0) {
+                fprintf(stderr, "Bad case: %s", line);
+                fclose(f);
+                return false;
+            }
+            cases.push_back(c);
+            continue;
+        }
+        if (cases.empty()) continue;
+        for(char *p = line; ; ) {
+            char *end;
+            const unsigned long pulse = strtoul(p, &end, 10);
+            if (end == p) break;
+            cases.back().pulses.push_back(pulse);
+            p = end;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// Status of the last packet framed from the pulses
+static int offlineStatus(const std::vector<uint32_t> &pulses) {
+    const timingProfile tp = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+    pulseFramer framer = {};
+    framer.lastSync = 1;
+    uint32_t timings[TIMINGS_BUFFER_SIZE];
+    uint8_t bytes[6];
+    int status = NO_PACKET;
+    for(size_t p = 0; p < pulses.size(); p++) {
+        if (!WS8610Receiver::addPulse(framer, pulses[p])) continue;
+        WS8610Receiver::copyTimings(framer, timings);
+        status = WS8610Receiver::decodeFrame(timings, tp, bytes);
+    }
+    return status;
+}
+
+// Prints the packet windows of a capture as corpus cases
+static int addCapture(const char *path) {
+    const timingProfile tp = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+    pulseFramer framer = {};
+    uint32_t timings[TIMINGS_BUFFER_SIZE];
+    uint8_t bytes[6];
+    long packets = 0;
+    const char *name = strrchr(path, '/');
+    name = (name != nullptr)? name + 1 : path;
+    printf("\n# Packets of %s\n", name);
+    const long pulses = capture::read(path, [&](uint32_t d) {
+        if (!WS8610Receiver::addPulse(framer, d)) return;
+        WS8610Receiver::copyTimings(framer, timings);
+        const frameStatus status = WS8610Receiver::decodeFrame(timings, tp, bytes);
+        printf("case %s_%ld %s", name, packets++, statusNames[status]);
+        if (status == FRAME_OK) {
+            const measure m = WS8610Receiver::frameMeasure(bytes, 0);
+            printf(" %s", formatMeasure(m.sensorAddr, m.type, measureTenths(m)).c_str());
+        }
+        for(int t = 0; t < TIMINGS_BUFFER_SIZE; t++) printf("%s%u", (t % 22 == 0)? "\n" : " ", timings[t]);
+        printf("\n");
+    });
+    if (pulses < 0) {
+        fprintf(stderr, "Can't open %s\n", path);
+        return 1;
+    }
+    fprintf(stderr, "%ld packets\n", packets);
+    return 0;
+}
+
+// Yield on one hour of 8 sensors with moderate impairments, always generated the same way
+static double syntheticYield(long &sent, long &decoded) {
+    const synth::impairments imp = { 100, 0.001, 0.01, 5000 };
+    synth::generator generator(8, 1, imp);
+    WS8610Receiver receiver(2);
+    receiver.enableReceive();
+    host::pulse(CASE_SEPARATOR);
+    host::drain(receiver, [](const measure&) {});
+    sent = decoded = 0;
+    generator.run(3600000000ULL, [&](uint32_t d) {
+        host::pulse(d);
+        host::drain(receiver, [&](const measure &m) { decoded += m.type != SENSOR_STALE; });
+    }, [&](const sentFrame&) { sent++; });
+    host::pulse(100000); // Ends the silence after the last frame
+    host::drain(receiver, [&](const measure &m) { decoded += m.type != SENSOR_STALE; });
+    receiver.disableReceive();
+    return (sent > 0)? 100.0 * decoded / sent : 0;
+}
+
+#ifdef WS8610_STALE_SENSORS
+// Silence of msec ms on the data pin, in pulses of a second at most, returning the measures given meanwhile
+static std::vector<measure> idle(WS8610Receiver &receiver, uint32_t msec) {
+    std::vector<measure> measures;
+    for(; msec > 0; ) {
+        const uint32_t step = (msec > 1000)? 1000 : msec;
+        host::pulse(step * 1000);
+        msec -= step;
+        host::drain(receiver, [&](const measure &m) { measures.push_back(m); });
+    }
+    return measures;
+}
+
+// Sends a good temperature frame of the sensor, returning the measures given
+static std::vector<measure> transmit(WS8610Receiver &receiver, const uint8_t sensorAddr, const int16_t tenths) {
+    const timingProfile tp = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+    uint8_t bytes[6];
+    uint32_t timings[TIMINGS_BUFFER_SIZE];
+    synth::encodeFrame(sensorAddr, TEMPERATURE, tenths, bytes);
+    synth::frameTimings(bytes, tp, CASE_SEPARATOR, timings);
+    std::vector<measure> measures;
+    host::replay(receiver, timings, TIMINGS_BUFFER_SIZE, [&](const measure &m) { measures.push_back(m); });
+    return measures;
+}
+
+static int staleEvents(const std::vector<measure> &measures, const uint8_t sensorAddr) {
+    int events = 0;
+    for(size_t m = 0; m < measures.size(); m++) events += measures[m].type == SENSOR_STALE && measures[m].sensorAddr == sensorAddr;
+    return events;
+}
+
+// Timed cases of the stale sensors on a new receiver, written to the report. Returns how many passed
+static int runStaleCases(FILE *report, int &total) {
+    WS8610Receiver receiver(2);
+    receiver.enableReceive();
+    host::pulse(CASE_SEPARATOR);
+    int passed = 0;
+    auto check = [&](const char *name, const bool ok, const std::string &got) {
+        total++;
+        if (ok) passed++;
+        fprintf(report, ok? "PASS %s\n" : "FAIL %s: got %s\n", name, got.c_str());
+    };
+    // The deadline is half a period after the last transmission missed, plus a tick at most
+    const uint32_t deadline = STALE_MISSED * STALE_PERIOD + STALE_PERIOD / 2;
+
+    std::vector<measure> measures = transmit(receiver, 45, 215);
+    uint32_t seen = millis();
+    check("stale_first_seen", measures.size() == 1 && !receiver.sensorStale(45),
+        std::to_string(measures.size()) + " measures");
+    measures = idle(receiver, deadline - 1000);
+    check("stale_not_before_deadline", staleEvents(measures, 45) == 0 && !receiver.sensorStale(45),
+        std::to_string(staleEvents(measures, 45)) + " events");
+
+    // Seen again before the deadline: the deadline moves on
+    transmit(receiver, 45, 216);
+    seen = millis();
+    measures = idle(receiver, 2000 + STALE_TICK);
+    check("stale_rescheduled", staleEvents(measures, 45) == 0 && !receiver.sensorStale(45),
+        std::to_string(staleEvents(measures, 45)) + " events");
+    measures = idle(receiver, deadline - 2000 - STALE_TICK - 1000);
+    check("stale_not_before_new_deadline", staleEvents(measures, 45) == 0, std::to_string(staleEvents(measures, 45)) + " events");
+
+    // Due in the tick after the deadline, delivered once through getNextMeasure()
+    measures = idle(receiver, 1000 + 2 * STALE_TICK);
+    const bool delivered = staleEvents(measures, 45) == 1 && measures.size() == 1 && measures[0].msec == seen;
+    check("stale_delivered", delivered && receiver.sensorStale(45),
+        std::to_string(staleEvents(measures, 45)) + " events, last seen " +
+        std::to_string(measures.empty()? 0 : measures[0].msec) + " (expected " + std::to_string(seen) + ")");
+    measures = idle(receiver, 3 * deadline);
+    check("stale_delivered_once", measures.empty() && receiver.sensorStale(45), std::to_string(measures.size()) + " measures");
+    check("stale_never_seen", !receiver.sensorStale(46), "sensor 46 stale");
+
+    // Back after a battery change
+    measures = transmit(receiver, 45, 217);
+    check("stale_seen_again", measures.size() == 1 && measures[0].type == TEMPERATURE && !receiver.sensorStale(45),
+        std::to_string(measures.size()) + " measures");
+    receiver.disableReceive();
+    return passed;
+}
+#endif
+
+#ifdef WS8610_ADAPTIVE_TIMING
+#define ADAPTIVE_CASE_YIELD 99.0 // % of the frames of the jittery sensor that must be decoded
+
+// A sensor with 150 µs of jitter for an hour, on a new receiver. Returns 1 if it passed
+static int runAdaptiveCase(FILE *report, int &total) {
+    const synth::impairments imp = { 150, 0, 0, 0 };
+    synth::generator generator(1, 7, imp);
+    WS8610Receiver receiver(2);
+    receiver.enableReceive();
+    host::pulse(CASE_SEPARATOR);
+    host::drain(receiver, [](const measure&) {});
+    long sent = 0, decoded = 0;
+    generator.run(3600000000ULL, [&](uint32_t d) {
+        host::pulse(d);
+        host::drain(receiver, [&](const measure&) { decoded++; });
+    }, [&](const sentFrame&) { sent++; });
+    host::pulse(100000);
+    host::drain(receiver, [&](const measure&) { decoded++; });
+    receiver.disableReceive();
+    const double yield = (sent > 0)? 100.0 * decoded / sent : 0;
+    total++;
+    if (yield >= ADAPTIVE_CASE_YIELD) {
+        fprintf(report, "PASS adaptive_jitter\n");
+        return 1;
+    }
+    fprintf(report, "FAIL adaptive_jitter: %ld/%ld frames decoded (%.2f%%)\n", decoded, sent, yield);
+    return 0;
+}
+#endif
+
+// Replays the cases through the receiver and writes their result to the report, returning how many passed.
+// With fresh set, the values of the previous cases don't count (WS8610_PLAUSIBILITY)
+static int runCases(WS8610Receiver &receiver, const std::vector<corpusCase> &cases, const bool fresh, FILE *report,
+                    int &good, int &goodDecoded) {
+    int passed = 0;
+    for(size_t c = 0; c < cases.size(); c++) {
+        const corpusCase &cc = cases[c];
+        std::string error;
+        const int status = offlineStatus(cc.pulses);
+        if (status != cc.status) error = std::string("status ") + statusNames[status];
+
+        // The separator completes nothing (the previous case ended with a sync), it only resets the framer
+        host::pulse(CASE_SEPARATOR);
+        host::drain(receiver, [](const measure&) {});
+#ifdef WS8610_PLAUSIBILITY
+        if (fresh) receiver.resetPlausibility();
+#endif
+#ifdef WS8610_ADAPTIVE_TIMING
+        if (fresh) receiver.resetTimingProfiles();
+#endif
+        (void)fresh;
+        std::vector<measure> measures;
+        host::replay(receiver, cc.pulses.data(), cc.pulses.size(), [&](const measure &m) { measures.push_back(m); });
+        const std::string expected = cc.hasMeasure? formatMeasure(cc.sensorAddr, cc.type, cc.tenths) : "no measure";
+        std::string got = "no measure";
+        for(size_t m = 0; m < measures.size(); m++) {
+            got = (m == 0? "" : got + ", ") + formatMeasure(measures[m].sensorAddr, measures[m].type, measureTenths(measures[m]));
+        }
+        if (got != expected) error += (error.empty()? "" : ", ") + std::string("measure ") + got;
+        if (cc.hasMeasure) {
+            good++;
+            if (measures.size() == 1 && got == expected) goodDecoded++;
+        }
+
+        if (error.empty()) {
+            passed++;
+            fprintf(report, "PASS %s\n", cc.name.c_str());
+        }
+        else {
+            fprintf(report, "FAIL %s: expected %s (%s), got %s\n", cc.name.c_str(), statusNames[cc.status],
+                expected.c_str(), error.c_str());
+        }
+    }
+    return passed;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2 && strcmp(argv[1], "-a") == 0) return addCapture(argv[2]);
+    const char *corpusPath = (argc > 1)? argv[1] : "extras/corpus/golden.txt";
+    const char *reportPath = (argc > 2)? argv[2] : "test_output.txt";
+#ifdef WS8610_PLAUSIBILITY
+    const char *plausibilityPath = "extras/corpus/plausibility.txt";
+#endif
+    std::vector<corpusCase> cases;
+    if (!readCorpus(corpusPath, cases)) {
+        fprintf(stderr, "Can't read %s\n", corpusPath);
+        return 1;
+    }
+    FILE *report = fopen(reportPath, "w");
+    if (report == nullptr) {
+        fprintf(stderr, "Can't write %s\n", reportPath);
+        return 1;
+    }
+
+    WS8610Receiver receiver(2);
+    receiver.enableReceive();
+    int good = 0, goodDecoded = 0;
+#ifdef WS8610_PLAUSIBILITY
+    // Only the digits are checked on the golden cases
+    receiver.setPlausibleRange(TEMPERATURE, -500, 999);
+    receiver.setPlausibleRange(HUMIDITY, 0, 999);
+#endif
+    int passed = runCases(receiver, cases, true, report, good, goodDecoded);
+    receiver.disableReceive();
+#ifdef WS8610_PLAUSIBILITY
+    std::vector<corpusCase> plausibilityCases;
+    if (!readCorpus(plausibilityPath, plausibilityCases)) {
+        fprintf(stderr, "Can't read %s\n", plausibilityPath);
+        fclose(report);
+        return 1;
+    }
+    WS8610Receiver plausibilityReceiver(2);
+    plausibilityReceiver.enableReceive();
+    fprintf(report, "\n# %s\n", plausibilityPath);
+    int plausibleGood = 0, plausibleDecoded = 0;
+    passed += runCases(plausibilityReceiver, plausibilityCases, false, report, plausibleGood, plausibleDecoded);
+    cases.insert(cases.end(), plausibilityCases.begin(), plausibilityCases.end());
+    plausibilityReceiver.disableReceive();
+#endif
+
+    int total = cases.size();
+#ifdef WS8610_ADAPTIVE_TIMING
+    fprintf(report, "\n# Adaptive timing\n");
+    passed += runAdaptiveCase(report, total);
+#endif
+#ifdef WS8610_STALE_SENSORS
+    fprintf(report, "\n# Stale sensors\n");
+    passed += runStaleCases(report, total);
+#endif
+
+    long sent, decoded;
+    const double yield = syntheticYield(sent, decoded);
+    const int failed = total - passed;
+    fprintf(report, "\n%d cases, %d passed, %d failed\n", total, passed, failed);
+    fprintf(report, "corpus yield: %d/%d good frames decoded\n", goodDecoded, good);
+    fprintf(report, "synthetic yield: %ld/%ld frames decoded (%.2f%%)\n", decoded, sent, yield);
+    fclose(report);
+    printf("%d cases, %d passed, %d failed, synthetic yield %.2f%% (report in %s)\n", total, passed,
+        failed, yield, reportPath);
+    return (failed > 0)? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/*
+  Converts a stream of sampled levels into a pulse capture, ready for the other tools.
+
+  Input formats:
+    bits   1 sample per bit, first sample in the least significant bit (packed logic analyzer data)
+    bytes  1 sample per byte, level in bit "channel" (e.g. sigrok-cli -O binary)
+    csv    1 sample per line, level (0 or 1) in the last field; lines not ending with a digit
+           or whose first field isn't a number (e.g. a header like "Time [s],Channel 0") are skipped.
+           With more than one field the first one is the time of the sample in seconds, so exports
+           listing only the transitions (e.g. Saleae's) keep their timing and sample_rate is ignored;
+           a single field is a sample at sample_rate
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/samples_to_pulses.cpp -o samples_to_pulses
+  Usage: samples_to_pulses format sample_rate input output [channel]
+  The output is a binary capture when its name ends with .wsc, otherwise a text one.
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BinaryCapture.h"
+#include "SampleStream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#define BLOCK_SIZE (1 << 20)
+
+int main(int argc, char *argv[]) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s bits|bytes|csv sample_rate input output [channel]\n", argv[0]);
+        return 1;
+    }
+    const char *format = argv[1];
+    const uint32_t rate = strtoul(argv[2], nullptr, 10);
+    const int channel = (argc > 5)? atoi(argv[5]) : 0;
+    FILE *in = (strcmp(argv[3], "-") == 0)? stdin : fopen(argv[3], "rb");
+    if (in == nullptr || rate == 0) {
+        fprintf(stderr, "Can't open %s\n", argv[3]);
+        return 1;
+    }
+
+    const size_t nameLength = strlen(argv[4]);
+    const bool binary = (nameLength > 4 && strcmp(argv[4] + nameLength - 4, ".wsc") == 0);
+    capture::writer writer;
+    FILE *text = nullptr;
+    if (binary? !writer.open(argv[4]) : (text = fopen(argv[4], "w")) == nullptr) {
+        fprintf(stderr, "Can't write %s\n", argv[4]);
+        return 1;
+    }
+    long pulses = 0;
+    auto onPulse = [&](uint32_t duration) {
+        if (binary) writer.addPulse(duration);
+        else fprintf(text, "%u\n", duration);
+        pulses++;
+    };
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    capture::edgeDetector detector(rate);
+    uint64_t timedRows = 0;                 // CSV lines with a time column
+    double firstTime = 0, lastTime = 0, lastEdge = 0;
+    uint8_t level = 0;
+    std::vector<uint64_t> words(BLOCK_SIZE / 8);
+    uint8_t *block = (uint8_t *)words.data();
+    if (strcmp(format, "bits") == 0) {
+        size_t read;
+        while((read = fread(block, 1, BLOCK_SIZE, in)) > 0) {
+            detector.addWords(words.data(), read / 8, onPulse);
+            // Remaining bytes, unpacked to one sample per byte
+            for(size_t b = read / 8 * 8; b < read; b++) {
+                uint8_t samples[8];
+                for(int s = 0; s < 8; s++) samples[s] = (block[b] >> s) & 1;
+                detector.addTail(samples, 8, 0, onPulse);
+            }
+        }
+    }
+    else if (strcmp(format, "bytes") == 0) {
+        size_t read;
+        while((read = fread(block, 1, BLOCK_SIZE, in)) > 0) detector.addBytes(block, read, channel, onPulse);
+    }
+    else if (strcmp(format, "csv") == 0) {
+        char line[256];
+        while(fgets(line, sizeof(line), in) != nullptr) {
+            size_t length = strcspn(line, "\r\n");
+            if (length == 0 || line[length - 1] < '0' || line[length - 1] > '9') continue;
+            char *end;
+            const double time = strtod(line, &end);
+            if (end == line) continue; // Header
+            const uint8_t sample = (line[length - 1] != '0');
+            if (end == line + length) {
+                detector.addTail(&sample, 1, 0, onPulse);
+                continue;
+            }
+            // Same as the edge detector: the level starts low, an edge on the first line only starts the first pulse
+            if (timedRows++ == 0) firstTime = lastEdge = time;
+            if (sample != level) {
+                if (time > firstTime) onPulse((uint32_t)((time - lastEdge) * 1e6 + 0.5));
+                lastEdge = time;
+                level = sample;
+            }
+            lastTime = time;
+        }
+    }
+    else {
+        fprintf(stderr, "Unknown format %s\n", format);
+        return 1;
+    }
+    if (in != stdin) fclose(in);
+    if (text != nullptr) fclose(text);
+    writer.close();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double captured = (double)detector.samples() / rate + (lastTime - firstTime);
+    if (timedRows > 0) {
+        fprintf(stderr, "%llu timed samples (%.1f s), %ld pulses in %.2f s, %.0fx real time\n",
+            (unsigned long long)timedRows, captured, pulses, seconds, captured / seconds);
+    }
+    else {
+        fprintf(stderr, "%llu samples (%.1f s at %u Hz), %ld pulses in %.2f s, %.0fx real time\n",
+            (unsigned long long)detector.samples(), captured, rate, pulses, seconds, captured / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+  Stress test of the packet queue between the interrupt handler and decodePacket(): the handler
+  runs on its own thread (host/ThreadedIsr.h) and gets back-to-back valid frames, all different
+  within STRESS_KEYS frames, while the main thread drains the receiver concurrently.
+
+  Since every frame sent is valid, a packet can only go wrong because of the concurrency:
+    torn       packets rejected by decodePacket() (read while the handler was overwriting them),
+               plus measures that don't match any frame sent (torn packets that passed the checks).
+               The main thread decodes one packet at a time and reads its measure right away, so
+               the measures buffer (MEASURE_BUFFER_SIZE, smaller than the packet queue) never wraps
+    lost       packets never read, overwritten before the main thread got to them
+
+  With -l the main thread drains inside noInterrupts(), the reference for a safe queue.
+  Build with -fsanitize=thread to have ThreadSanitizer report the unsynchronized accesses.
+
+  Build: g++ -std=c++11 -O2 -pthread -I extras/host -I . extras/tools/stress_isr.cpp -o stress_isr
+  Usage: stress_isr [-f frames] [-x speed] [-p poll usec] [-l]
+    -f frames     frames to send (default 1000000)
+    -x speed      simulated time per real time, 1 is real time (default 0, as fast as possible)
+    -p usec       pause of the main thread between two polls (default 0)
+*/
+
+#define WS8610_HOST_THREADS
+#define WS8610_PACKET_STATS
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "Synth.h"
+#include "ThreadedIsr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define STRESS_KEYS 256000 // 128 sensors x 2 types x 1000 values
+#define STRESS_SYNC 10000  // Sync signal after each frame (µs)
+
+static void keyMeasure(const uint32_t key, uint8_t &addr, measureType &type, int16_t &tenths) {
+    addr = key % 128;
+    type = (measureType)((key / 128) % 2);
+    tenths = (key / 256) % 1000 - ((type == TEMPERATURE)? 500 : 0);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t frames = 1000000;
+    double speed = 0;
+    uint32_t pollUsec = 0;
+    bool locked = false;
+    for(int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-l") == 0) locked = true;
+        else if (a + 1 < argc && strcmp(argv[a], "-f") == 0) frames = strtoull(argv[++a], nullptr, 10);
+        else if (a + 1 < argc && strcmp(argv[a], "-x") == 0) speed = atof(argv[++a]);
+        else if (a + 1 < argc && strcmp(argv[a], "-p") == 0) pollUsec = atoi(argv[++a]);
+        else {
+            fprintf(stderr, "Usage: %s [-f frames] [-x speed] [-p poll usec] [-l]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const timingProfile tp = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+    std::vector<uint32_t> sent(STRESS_KEYS, 0), received(STRESS_KEYS, 0);
+    for(uint64_t f = 0; f < frames; f++) sent[f % STRESS_KEYS]++;
+
+    // The handler thread renders the frames one at a time, after a first sync signal
+    uint64_t frame = 0;
+    int pos = TIMINGS_BUFFER_SIZE;
+    uint32_t timings[TIMINGS_BUFFER_SIZE];
+    bool first = true;
+    auto source = [&](uint32_t &duration) {
+        if (first) {
+            first = false;
+            duration = STRESS_SYNC;
+            return true;
+        }
+        if (pos == TIMINGS_BUFFER_SIZE) {
+            if (frame == frames) return false;
+            uint8_t addr, bytes[6];
+            measureType type;
+            int16_t tenths;
+            keyMeasure(frame % STRESS_KEYS, addr, type, tenths);
+            synth::encodeFrame(addr, type, tenths, bytes);
+            synth::frameTimings(bytes, tp, STRESS_SYNC, timings);
+            frame++;
+            pos = 0;
+        }
+        duration = timings[pos++];
+        return true;
+    };
+
+    WS8610Receiver receiver(2);
+    receiver.enableReceive();
+    uint64_t measures = 0;
+    auto onMeasure = [&](const measure &m) {
+        const int tenths = measureTenths(m) + ((m.type == TEMPERATURE)? 500 : 0);
+        if (tenths >= 0 && tenths < 1000) received[(uint32_t)tenths * 256 + m.type * 128 + (m.sensorAddr & 0x7F)]++;
+        measures++;
+    };
+    auto poll = [&]() {
+        if (locked) noInterrupts();
+        do {
+            for(int n = receiver.receivedMeasures(1, 0); n > 0; n--) onMeasure(receiver.getNextMeasure());
+        } while(receiver.pendingPackets() > 0);
+        if (locked) interrupts();
+    };
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    host::isrThread isr;
+    isr.start(source, speed);
+    while(isr.running()) {
+        poll();
+        if (pollUsec > 0) std::this_thread::sleep_for(std::chrono::microseconds(pollUsec));
+        else std::this_thread::yield();
+    }
+    isr.join();
+    poll();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    receiver.disableReceive();
+
+    uint64_t recovered = 0, corrupted = 0;
+    for(uint32_t k = 0; k < STRESS_KEYS; k++) {
+        recovered += (received[k] < sent[k])? received[k] : sent[k];
+        if (received[k] > sent[k]) corrupted += received[k] - sent[k];
+    }
+    const packetStats stats = receiver.getPacketStats();
+    const uint64_t lost = frames - stats.decoded - stats.rejected;
+    printf("%llu frames (%llu pulses) in %.2f s, %s consumer\n", (unsigned long long)frames,
+        (unsigned long long)isr.pulses(), seconds, locked? "locked" : "lock-free");
+    printf("recovered %llu (%.3f%%), torn %llu (%u rejected, %llu corrupted), lost %llu\n",
+        (unsigned long long)recovered, 100.0 * recovered / frames, (unsigned long long)(stats.rejected + corrupted),
+        stats.rejected, (unsigned long long)corrupted, (unsigned long long)lost);
+    return 0;
+}
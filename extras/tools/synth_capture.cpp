@@ -0,0 +1,129 @@
+/*
+  Generates a synthetic capture of N sensors with the impairments of host/Synth.h, and the list
+  of the frames sent (ground truth) to check the decoder yield against.
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/synth_capture.cpp -o synth_capture
+  Usage: synth_capture [options] output [truth.csv]
+    -n sensors      (default 4)
+    -d seconds      of traffic (default 3600)
+    -j jitter       max pulse jitter in µs (default 0)
+    -g rate         glitch probability per pulse (default 0)
+    -p rate         dropout probability per frame (default 0)
+    -l usec         dropout length (default 5000)
+    -s seed         (default 1)
+    -b              benchmark: checks the frame encoding, then measures the generation speed without output
+  The output is a binary capture when its name ends with .wsc, otherwise a text one.
+  Truth (CSV): usec,sensor,type,value,flags (1 = collided, 2 = dropout)
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BinaryCapture.h"
+#include "Synth.h"
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+// Every measure value of every sensor must decode back to itself
+static bool checkEncoding() {
+    const timingProfile tp = { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE };
+    uint8_t bytes[6], decoded[6];
+    uint32_t timings[TIMINGS_BUFFER_SIZE];
+    for(int addr = 0; addr < 128; addr++) {
+        for(int type = TEMPERATURE; type <= HUMIDITY; type++) {
+            for(int tenths = (type == TEMPERATURE)? -500 : 0; tenths < ((type == TEMPERATURE)? 500 : 1000); tenths++) {
+                synth::encodeFrame(addr, (measureType)type, tenths, bytes);
+                synth::frameTimings(bytes, tp, 20000, timings);
+                const frameStatus status = WS8610Receiver::decodeFrame(timings, tp, decoded);
+                const measure m = WS8610Receiver::frameMeasure(decoded, 0);
+                if (status != FRAME_OK || memcmp(bytes, decoded, 6) != 0 ||
+                    m.sensorAddr != addr || m.type != type || measureTenths(m) != tenths) {
+                    fprintf(stderr, "Encoding mismatch: sensor %d, type %d, value %d (decoded %d)\n",
+                        addr, type, tenths, measureTenths(m));
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int sensors = 4;
+    double seconds = 3600;
+    uint64_t seed = 1;
+    bool benchmark = false;
+    synth::impairments imp = { 0, 0, 0, 5000 };
+    int a = 1;
+    for(; a < argc && argv[a][0] == '-'; a += 2) {
+        if (argv[a][1] == 'b') {
+            benchmark = true;
+            a--;
+            continue;
+        }
+        if (a + 1 >= argc) break;
+        if (argv[a][1] == 'n') sensors = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'd') seconds = atof(argv[a + 1]);
+        else if (argv[a][1] == 'j') imp.jitter = atoi(argv[a + 1]);
+        else if (argv[a][1] == 'g') imp.glitchRate = atof(argv[a + 1]);
+        else if (argv[a][1] == 'p') imp.dropoutRate = atof(argv[a + 1]);
+        else if (argv[a][1] == 'l') imp.dropoutUsec = atoi(argv[a + 1]);
+        else if (argv[a][1] == 's') seed = strtoull(argv[a + 1], nullptr, 10);
+        else break;
+    }
+    if ((a >= argc && !benchmark) || sensors < 1 || sensors > 128) {
+        fprintf(stderr, "Usage: %s [-n sensors] [-d seconds] [-j jitter] [-g glitch rate] [-p dropout rate] "
+            "[-l dropout usec] [-s seed] [-b] output [truth.csv]\n", argv[0]);
+        return 1;
+    }
+
+    synth::generator generator(sensors, seed, imp);
+    if (benchmark) {
+        if (!checkEncoding()) return 1;
+        uint64_t checksum = 0, pulses = 0, frames = 0;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        generator.run((uint64_t)(seconds * 1000000), [&](uint32_t d) { checksum += d; pulses++; },
+            [&](const sentFrame &f) { checksum += f.tenths; frames++; });
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%llu frames, %llu pulses in %.3f s: %.2f M frames/s, %.1f M pulses/s (checksum %llu)\n",
+            (unsigned long long)frames, (unsigned long long)pulses, elapsed, frames / elapsed / 1e6,
+            pulses / elapsed / 1e6, (unsigned long long)checksum);
+        return 0;
+    }
+
+    const size_t nameLength = strlen(argv[a]);
+    const bool binary = (nameLength > 4 && strcmp(argv[a] + nameLength - 4, ".wsc") == 0);
+    capture::writer writer;
+    FILE *text = nullptr, *truth = nullptr;
+    if (binary? !writer.open(argv[a]) : (text = fopen(argv[a], "w")) == nullptr) {
+        fprintf(stderr, "Can't write %s\n", argv[a]);
+        return 1;
+    }
+    if (a + 1 < argc && (truth = fopen(argv[a + 1], "w")) == nullptr) {
+        fprintf(stderr, "Can't write %s\n", argv[a + 1]);
+        return 1;
+    }
+    if (text != nullptr) {
+        fprintf(text, "# synth_capture sensors=%d seconds=%g jitter=%u glitches=%g dropouts=%g/%u seed=%llu\n",
+            sensors, seconds, imp.jitter, imp.glitchRate, imp.dropoutRate, imp.dropoutUsec, (unsigned long long)seed);
+    }
+    if (truth != nullptr) fprintf(truth, "usec,sensor,type,value,flags\n");
+    long frames = 0, impaired = 0;
+    auto onPulse = [&](uint32_t duration) {
+        if (binary) writer.addPulse(duration);
+        else fprintf(text, "%u\n", duration);
+    };
+    generator.run((uint64_t)(seconds * 1000000), onPulse, [&](const sentFrame &f) {
+        frames++;
+        if (f.flags != 0) impaired++;
+        if (truth == nullptr) return;
+        fprintf(truth, "%llu,%u,%s,%s%d.%d,%u\n", (unsigned long long)f.usec, f.sensorAddr,
+            (f.type == TEMPERATURE)? "T" : "H", (f.tenths < 0)? "-" : "", abs(f.tenths) / 10, abs(f.tenths) % 10, f.flags);
+    });
+    onPulse(100000); // Ends the silence after the last frame
+    if (text != nullptr) fclose(text);
+    if (truth != nullptr) fclose(truth);
+    writer.close();
+    fprintf(stderr, "%ld frames sent, %ld collided or with a dropout\n", frames, impaired);
+    return 0;
+}
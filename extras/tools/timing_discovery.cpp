@@ -0,0 +1,152 @@
+/*
+  Derives the protocol timings from a capture: clusters the pulse durations into SHORT, FIXED
+  and LONG (1-D k-means), proposes PW_*, PW_TOLERANCE, NOISE_THRESHOLD and the sync threshold,
+  then decodes the capture with both the current and the proposed pulse widths to compare the yield.
+
+  Build: g++ -std=c++11 -O2 -I extras/host -I . extras/tools/timing_discovery.cpp -o timing_discovery
+  Usage: timing_discovery capture.txt [more captures...]
+*/
+
+#include "Arduino.h"
+#include "WS8610Receiver.h"
+#include "BinaryCapture.h"
+#include "Replay.h"
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#define DATA_PULSE_MIN 250   // Pulses considered for clustering
+#define DATA_PULSE_MAX 3000
+#define KMEANS_ROUNDS 50
+
+struct cluster {
+    double center;
+    size_t size;
+    uint32_t spread; // 99.5th percentile of the distance from the center
+};
+
+// 1-D k-means with 3 clusters (SHORT, FIXED, LONG), started from the 1/6, 1/2, 5/6 quantiles
+static bool findClusters(std::vector<uint32_t> data, cluster clusters[3]) {
+    if (data.size() < 100) return false;
+    std::sort(data.begin(), data.end());
+    for(int c = 0; c < 3; c++) clusters[c].center = data[data.size() * (2 * c + 1) / 6];
+
+    std::vector<uint8_t> owner(data.size());
+    for(int round = 0; round < KMEANS_ROUNDS; round++) {
+        double sums[3] = {0};
+        size_t sizes[3] = {0};
+        for(size_t d = 0; d < data.size(); d++) {
+            int best = 0;
+            for(int c = 1; c < 3; c++) {
+                if (fabs(data[d] - clusters[c].center) < fabs(data[d] - clusters[best].center)) best = c;
+            }
+            owner[d] = best;
+            sums[best] += data[d];
+            sizes[best]++;
+        }
+        bool moved = false;
+        for(int c = 0; c < 3; c++) {
+            if (sizes[c] == 0) return false;
+            const double center = sums[c] / sizes[c];
+            if (fabs(center - clusters[c].center) > 0.5) moved = true;
+            clusters[c].center = center;
+            clusters[c].size = sizes[c];
+        }
+        if (!moved) break;
+    }
+
+    for(int c = 0; c < 3; c++) {
+        std::vector<uint32_t> distances;
+        for(size_t d = 0; d < data.size(); d++) {
+            if (owner[d] == c) distances.push_back((uint32_t)fabs(data[d] - clusters[c].center));
+        }
+        std::sort(distances.begin(), distances.end());
+        clusters[c].spread = distances[distances.size() * 995 / 1000];
+    }
+    return true;
+}
+
+struct yield {
+    size_t measures;
+    size_t sensors;
+};
+
+static yield decodeYield(const std::vector<uint32_t> &pulses, const timingProfile &tp) {
+    WS8610Receiver receiver(2);
+    receiver.setNominalTiming(tp);
+    receiver.enableReceive();
+    bool seen[128] = {false};
+    yield y = {0, 0};
+    auto onMeasure = [&](const measure &m) {
+        y.measures++;
+        if (!seen[m.sensorAddr & 0x7F]) {
+            seen[m.sensorAddr & 0x7F] = true;
+            y.sensors++;
+        }
+    };
+    host::replay(receiver, pulses.data(), pulses.size(), onMeasure);
+    host::pulse(100000); // Flushes the last packet
+    host::drain(receiver, onMeasure);
+    return y;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s capture.txt [more captures...]\n", argv[0]);
+        return 1;
+    }
+    std::vector<uint32_t> pulses;
+    for(int a = 1; a < argc; a++) {
+        if (capture::read(argv[a], [&](uint32_t d) { pulses.push_back(d); }) < 0) {
+            fprintf(stderr, "Can't open %s\n", argv[a]);
+            return 1;
+        }
+    }
+
+    std::vector<uint32_t> data;
+    for(size_t p = 0; p < pulses.size(); p++) {
+        if (pulses[p] >= DATA_PULSE_MIN && pulses[p] <= DATA_PULSE_MAX) data.push_back(pulses[p]);
+    }
+    cluster clusters[3];
+    if (!findClusters(data, clusters)) {
+        fprintf(stderr, "Not enough data pulses (%zu) to find the timings\n", data.size());
+        return 1;
+    }
+    const char *names[3] = {"SHORT", "FIXED", "LONG"};
+    printf("%zu pulses, %zu between %d and %d µs\n", pulses.size(), data.size(), DATA_PULSE_MIN, DATA_PULSE_MAX);
+    for(int c = 0; c < 3; c++) {
+        printf("%-5s center %4.0f µs, %7zu pulses, 99.5%% within ±%u µs\n",
+            names[c], clusters[c].center, clusters[c].size, clusters[c].spread);
+    }
+
+    timingProfile proposed;
+    proposed.shortPw = lround(clusters[0].center);
+    proposed.fixedPw = lround(clusters[1].center);
+    proposed.longPw = lround(clusters[2].center);
+    // Tolerance covers the widest cluster with a 20% margin, but SHORT and LONG windows must not overlap
+    uint32_t tolerance = 0;
+    for(int c = 0; c < 3; c++) tolerance = std::max(tolerance, clusters[c].spread * 6 / 5);
+    proposed.tolerance = std::min<uint32_t>(tolerance, (proposed.longPw - proposed.shortPw) / 2);
+    // Noise is anything shorter than half the shortest valid pulse
+    const uint32_t noiseThreshold = (proposed.shortPw - proposed.tolerance) / 2;
+    // Sync threshold is between the longest valid pulse and the shortest gap between packets
+    const uint32_t maxData = proposed.longPw + proposed.tolerance;
+    uint32_t minGap = 0;
+    for(size_t p = 0; p < pulses.size(); p++) {
+        if (pulses[p] > 3 * maxData && (minGap == 0 || pulses[p] < minGap)) minGap = pulses[p];
+    }
+    const uint32_t syncThreshold = (minGap > 0)? lround(sqrt((double)maxData * minGap) / 100) * 100 : 5000;
+
+    printf("\nProposed constants:\n");
+    printf("#define PW_FIXED %u\n#define PW_SHORT %u\n#define PW_LONG %u\n#define PW_TOLERANCE %u\n",
+        proposed.fixedPw, proposed.shortPw, proposed.longPw, proposed.tolerance);
+    printf("#define NOISE_THRESHOLD %u\n", noiseThreshold);
+    printf("Sync threshold: %u µs (currently 5000)%s\n", syncThreshold, (minGap > 0)? "" : ", no gaps found");
+
+    const yield current = decodeYield(pulses, { PW_FIXED, PW_SHORT, PW_LONG, PW_TOLERANCE });
+    const yield candidate = decodeYield(pulses, proposed);
+    printf("\nDecode yield (NOISE_THRESHOLD %d and sync threshold 5000 in both runs):\n", NOISE_THRESHOLD);
+    printf("current:  %7zu measures from %3zu sensors\n", current.measures, current.sensors);
+    printf("proposed: %7zu measures from %3zu sensors\n", candidate.measures, candidate.sensors);
+    return 0;
+}